@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Compare two benchmark result files written by run.p4.
+#
+# usage: compare.sh old.json new.json
+#
+# A change is marked when the medians differ by more than twice the
+# larger standard deviation.
+#
+
+if [ $# -ne 2 ]; then
+	echo "usage: $0 old.json new.json" >&2
+	exit 2
+fi
+
+awk '
+function field(line, key,	v) {
+	if (match(line, "\"" key "\": *[^,}]*") == 0)
+		return ""
+	v = substr(line, RSTART, RLENGTH)
+	sub(/^"[^"]*": */, "", v)
+	gsub(/"/, "", v)
+	return v
+}
+/"name"/ {
+	name = field($0, "name")
+	if (FNR == NR) {
+		old[name] = field($0, "median_ns")
+		olddev[name] = field($0, "stddev_ns")
+	} else {
+		new[name] = field($0, "median_ns")
+		newdev[name] = field($0, "stddev_ns")
+		order[++n] = name
+	}
+}
+END {
+	printf "%-24s %14s %14s %8s\n", "benchmark", "old ns", "new ns", "change"
+	for (i = 1; i <= n; i++) {
+		name = order[i]
+		if (!(name in old)) {
+			printf "%-24s %14s %14.3f %8s\n", name, "-", new[name], "new"
+			continue
+		}
+		pct = old[name] == 0 ? 0 : 100 * (new[name] - old[name]) / old[name]
+		noise = olddev[name] < newdev[name] ? newdev[name] : olddev[name]
+		diff = new[name] - old[name]
+		mark = (diff < 0 ? -diff : diff) <= 2 * noise ? "" : diff < 0 ? " faster" : " slower"
+		printf "%-24s %14.3f %14.3f %+7.1f%%%s\n", name, old[name], new[name], pct, mark
+	}
+	for (name in old) {
+		if (!(name in new))
+			printf "%-24s %14.3f %14s %8s\n", name, old[name], "-", "gone"
+	}
+}
+' "$1" "$2"
@@ -0,0 +1,313 @@
+/*
+ * arena.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+#endif
+
+#ifndef P4_ARENA_MIN
+#define P4_ARENA_MIN		1024		/* in bytes */
+#endif
+
+#ifndef P4_SCRATCH_SIZE
+#define P4_SCRATCH_SIZE		4096		/* in bytes */
+#endif
+
+/* Size of memory released by arena-reset beyond which the pages are
+ * returned to the system, while keeping the chunk; 0 to disable.
+ */
+#ifndef P4_ARENA_DONTNEED
+#define P4_ARENA_DONTNEED	(1024 * 1024)	/* in bytes */
+#endif
+
+typedef struct p4_arena_chunk P4_Arena_Chunk;
+
+struct p4_arena_chunk {
+	P4_Arena_Chunk *	prev;
+	size_t			size;
+	size_t			used;
+	P4_Cell			data[];
+};
+
+/*
+ * An arena is a stack of chunks, each double the size of the previous,
+ * so n bytes of allocation take O(log n) calls to malloc.  Marks are
+ * simply the address of the next free byte.
+ */
+typedef struct {
+	P4_Arena_Chunk *	chunk;
+} P4_Arena;
+
+static P4_Arena_Chunk *
+p4ArenaChunk(P4_Arena_Chunk *prev, size_t size)
+{
+	P4_Arena_Chunk *chunk;
+	if (SIZE_MAX - sizeof (*chunk) < size) {
+		return NULL;
+	}
+	if ((chunk = malloc(sizeof (*chunk) + size)) != NULL) {
+		chunk->prev = prev;
+		chunk->size = size;
+		chunk->used = 0;
+	}
+	return chunk;
+}
+
+static P4_Arena *
+p4ArenaPop(P4_Ctx *ctx)
+{
+	P4_Arena *arena = P4_POP(ctx->ds).v;
+	if (arena == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_SIGSEGV);
+	}
+	return arena;
+}
+
+static void *
+p4ArenaAlloc(P4_Ctx *ctx, P4_Arena *arena, size_t size, size_t align)
+{
+	P4_Arena_Chunk *chunk = arena->chunk;
+	P4_Char *base = (P4_Char *) chunk->data;
+	P4_Uint offset = P4_ALIGN_SIZE((P4_Uint) base + chunk->used, align) - (P4_Uint) base;
+
+	if (chunk->size < offset || chunk->size - offset < size) {
+		size_t next;
+		/* A new chunk has room for size plus alignment padding. */
+		if (SIZE_MAX - align < size) {
+			LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+		}
+		next = chunk->size <= SIZE_MAX / 2 ? chunk->size * 2 : SIZE_MAX;
+		if (next < size + align) {
+			next = size + align;
+		}
+		if ((chunk = p4ArenaChunk(chunk, next)) == NULL) {
+			LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+		}
+		arena->chunk = chunk;
+		base = (P4_Char *) chunk->data;
+		offset = P4_ALIGN_SIZE((P4_Uint) base, align) - (P4_Uint) base;
+	}
+	chunk->used = offset + size;
+	return base + offset;
+}
+
+static P4_Arena *
+p4ArenaCreate(P4_Ctx *ctx, size_t size)
+{
+	P4_Arena *arena;
+	if (size < P4_ARENA_MIN) {
+		size = P4_ARENA_MIN;
+	}
+	if ((arena = malloc(sizeof (*arena))) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	if ((arena->chunk = p4ArenaChunk(NULL, size)) == NULL) {
+		free(arena);
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	return arena;
+}
+
+static void
+p4ArenaDestroy(P4_Arena *arena)
+{
+	P4_Arena_Chunk *prev;
+	if (arena != NULL) {
+		for ( ; arena->chunk != NULL; arena->chunk = prev) {
+			prev = arena->chunk->prev;
+			free(arena->chunk);
+		}
+		free(arena);
+	}
+}
+
+/*
+ * arena-new ( u -- arena )
+ */
+static void
+p4ArenaNew(P4_Ctx *ctx)
+{
+	P4_TOP(ctx->ds).v = p4ArenaCreate(ctx, P4_TOP(ctx->ds).z);
+}
+
+/*
+ * arena-alloc ( u arena -- aaddr )
+ */
+static void
+p4ArenaAllocHook(P4_Ctx *ctx)
+{
+	P4_Arena *arena = p4ArenaPop(ctx);
+	P4_TOP(ctx->ds).v = p4ArenaAlloc(ctx, arena, P4_TOP(ctx->ds).z, sizeof (P4_Cell));
+}
+
+/*
+ * arena-alloc-aligned ( u1 u2 arena -- addr )
+ */
+static void
+p4ArenaAllocAligned(P4_Ctx *ctx)
+{
+	P4_Arena *arena = p4ArenaPop(ctx);
+	size_t align = P4_POP(ctx->ds).z;
+	if (align == 0 || (align & (align - 1)) != 0) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+	}
+	P4_TOP(ctx->ds).v = p4ArenaAlloc(ctx, arena, P4_TOP(ctx->ds).z, align);
+}
+
+static void *
+p4ArenaMarkOf(P4_Arena *arena)
+{
+	return (P4_Char *) arena->chunk->data + arena->chunk->used;
+}
+
+/*
+ * arena-mark ( arena -- mark )
+ */
+static void
+p4ArenaMark(P4_Ctx *ctx)
+{
+	P4_TOP(ctx->ds).v = p4ArenaMarkOf(P4_TOP(ctx->ds).v);
+}
+
+/*
+ * Give the pages between the mark and the old end of the chunk back to
+ * the system, keeping the address space for reuse.
+ */
+static void
+p4ArenaDontNeed(P4_Char *start, P4_Char *end)
+{
+#if defined(MADV_DONTNEED) && 0 < P4_ARENA_DONTNEED
+	if (P4_ARENA_DONTNEED <= end - start) {
+		P4_Uint page = (P4_Uint) sysconf(_SC_PAGESIZE);
+		P4_Uint lo = P4_ALIGN_SIZE(start, page);
+		P4_Uint hi = (P4_Uint) end & -page;
+		if (lo < hi) {
+			(void) madvise((void *) lo, hi - lo, MADV_DONTNEED);
+		}
+	}
+#endif
+}
+
+static void
+p4ArenaRewind(P4_Ctx *ctx, P4_Arena *arena, P4_Char *mark)
+{
+	P4_Arena_Chunk *chunk, *prev;
+
+	/* Zero resets to the empty arena, ie. the oldest chunk. */
+	for (chunk = arena->chunk; chunk->prev != NULL; chunk = chunk->prev) {
+		if (mark != NULL && (P4_Char *) chunk->data <= mark
+		&& mark <= (P4_Char *) chunk->data + chunk->used) {
+			break;
+		}
+	}
+	if (mark == NULL) {
+		mark = (P4_Char *) chunk->data;
+	} else if (mark < (P4_Char *) chunk->data || (P4_Char *) chunk->data + chunk->used < mark) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+	}
+	while (arena->chunk != chunk) {
+		prev = arena->chunk->prev;
+		free(arena->chunk);
+		arena->chunk = prev;
+	}
+	p4ArenaDontNeed(mark, (P4_Char *) chunk->data + chunk->used);
+	chunk->used = mark - (P4_Char *) chunk->data;
+}
+
+/*
+ * arena-reset ( mark arena -- )
+ */
+static void
+p4ArenaReset(P4_Ctx *ctx)
+{
+	P4_Arena *arena = p4ArenaPop(ctx);
+	p4ArenaRewind(ctx, arena, P4_POP(ctx->ds).v);
+}
+
+/*
+ * arena-free ( arena -- )
+ */
+static void
+p4ArenaFree(P4_Ctx *ctx)
+{
+	p4ArenaDestroy(P4_POP(ctx->ds).v);
+}
+
+/*
+ * Each context has a scratch arena, created on first use, for temporary
+ * buffers released by WITH-SCRATCH, or when an uncaught exception returns
+ * to the REPL.
+ */
+static P4_Arena *
+p4ScratchArena(P4_Ctx *ctx)
+{
+	if (ctx->scratch == NULL) {
+		ctx->scratch = p4ArenaCreate(ctx, P4_SCRATCH_SIZE);
+	}
+	return ctx->scratch;
+}
+
+void
+p4ScratchReset(P4_Ctx *ctx)
+{
+	if (ctx->scratch != NULL) {
+		p4ArenaRewind(ctx, ctx->scratch, NULL);
+	}
+}
+
+void
+p4ScratchFree(P4_Ctx *ctx)
+{
+	p4ArenaDestroy(ctx->scratch);
+	ctx->scratch = NULL;
+}
+
+/*
+ * scratch ( u -- aaddr )
+ */
+static void
+p4Scratch(P4_Ctx *ctx)
+{
+	P4_TOP(ctx->ds).v = p4ArenaAlloc(ctx, p4ScratchArena(ctx), P4_TOP(ctx->ds).z, sizeof (P4_Cell));
+}
+
+/*
+ * scratch-mark ( -- mark )
+ */
+static void
+p4ScratchMark(P4_Ctx *ctx)
+{
+	p4AllocStack(ctx, &ctx->ds, 1);
+	P4_PUSH(ctx->ds, p4ArenaMarkOf(p4ScratchArena(ctx)));
+}
+
+/*
+ * scratch-reset ( mark -- )
+ */
+static void
+p4ScratchResetHook(P4_Ctx *ctx)
+{
+	p4ArenaRewind(ctx, p4ScratchArena(ctx), P4_POP(ctx->ds).v);
+}
+
+P4_Hook p4_arena_hooks[] = {
+	P4_HOOK(0x11, "arena-new", p4ArenaNew),
+	P4_HOOK(0x21, "arena-alloc", p4ArenaAllocHook),
+	P4_HOOK(0x31, "arena-alloc-aligned", p4ArenaAllocAligned),
+	P4_HOOK(0x11, "arena-mark", p4ArenaMark),
+	P4_HOOK(0x20, "arena-reset", p4ArenaReset),
+	P4_HOOK(0x10, "arena-free", p4ArenaFree),
+	P4_HOOK(0x11, "scratch", p4Scratch),
+	P4_HOOK(0x01, "scratch-mark", p4ScratchMark),
+	P4_HOOK(0x10, "scratch-reset", p4ScratchResetHook),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
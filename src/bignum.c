@@ -0,0 +1,717 @@
+/*
+ * bignum.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+/*
+ * Arbitrary precision integers as sign and magnitude, the magnitude
+ * an array of limbs, least significant first, with no leading zero
+ * limbs; zero has no limbs.  Products and quotients of limbs use an
+ * integer twice the width of a limb.
+ */
+#if defined(__SIZEOF_INT128__) && P4_UINT_BITS == 64
+typedef uint64_t P4_Limb;
+typedef unsigned __int128 P4_Limb2;
+# define P4_LIMB_BITS		64
+#else
+typedef uint32_t P4_Limb;
+typedef uint64_t P4_Limb2;
+# define P4_LIMB_BITS		32
+#endif
+
+/* Below this many limbs, schoolbook multiplication is faster. */
+#ifndef P4_BIG_KARATSUBA
+#define P4_BIG_KARATSUBA	32		/* in limbs */
+#endif
+
+typedef struct {
+	int		neg;
+	size_t		length;
+	P4_Limb *	limb;
+	char *		string;		/* See big>string */
+} P4_Bignum;
+
+/***********************************************************************
+ *** Magnitudes
+ ***********************************************************************/
+
+static size_t
+p4MagNorm(const P4_Limb *a, size_t n)
+{
+	while (0 < n && a[n-1] == 0) {
+		n--;
+	}
+	return n;
+}
+
+static int
+p4MagCmp(const P4_Limb *a, size_t na, const P4_Limb *b, size_t nb)
+{
+	if (na != nb) {
+		return na < nb ? -1 : 1;
+	}
+	while (0 < na--) {
+		if (a[na] != b[na]) {
+			return a[na] < b[na] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+/* r = a + b, nb <= na; r may be a or b.  Return the carry. */
+static P4_Limb
+p4MagAdd(P4_Limb *r, const P4_Limb *a, size_t na, const P4_Limb *b, size_t nb)
+{
+	size_t i;
+	P4_Limb s, carry = 0;
+	for (i = 0; i < nb; i++) {
+		s = a[i] + carry;
+		carry = s < carry;
+		s += b[i];
+		carry += s < b[i];
+		r[i] = s;
+	}
+	for ( ; i < na; i++) {
+		s = a[i] + carry;
+		carry = s < carry;
+		r[i] = s;
+	}
+	return carry;
+}
+
+/* r = a - b, nb <= na, b <= a; r may be a or b.  Return the borrow. */
+static P4_Limb
+p4MagSub(P4_Limb *r, const P4_Limb *a, size_t na, const P4_Limb *b, size_t nb)
+{
+	size_t i;
+	P4_Limb x, d, borrow = 0;
+	for (i = 0; i < nb; i++) {
+		x = a[i];
+		d = x - b[i];
+		x = x < b[i];
+		r[i] = d - borrow;
+		borrow = x | (d < borrow);
+	}
+	for ( ; i < na; i++) {
+		x = a[i];
+		r[i] = x - borrow;
+		borrow = x < borrow;
+	}
+	return borrow;
+}
+
+/* r[0, na+nb) = a * b; r is neither a nor b. */
+static void
+p4MagMulSchool(P4_Limb *r, const P4_Limb *a, size_t na, const P4_Limb *b, size_t nb)
+{
+	P4_Limb2 t;
+	P4_Limb carry;
+
+	(void) memset(r, 0, (na + nb) * sizeof (*r));
+	for (size_t j = 0; j < nb; j++) {
+		carry = 0;
+		for (size_t i = 0; i < na; i++) {
+			t = (P4_Limb2) a[i] * b[j] + r[i+j] + carry;
+			r[i+j] = (P4_Limb) t;
+			carry = (P4_Limb) (t >> P4_LIMB_BITS);
+		}
+		r[na+j] = carry;
+	}
+}
+
+/*
+ * r[0, na+nb) = a * b, nb <= na; r is neither a nor b.  Karatsuba
+ * splits a = a1 B^h + a0 and b = b1 B^h + b0, so that
+ *
+ *	a b = z2 B^2h + ((a0 + a1)(b0 + b1) - z2 - z0) B^h + z0
+ *
+ * with z2 = a1 b1 and z0 = a0 b0, three multiplies instead of four.
+ * Should a temporary not be allocated, fall back to the schoolbook.
+ */
+static void
+p4MagMul(P4_Limb *r, const P4_Limb *a, size_t na, const P4_Limb *b, size_t nb)
+{
+	size_t h, i, c, lsa, lsb, nz;
+	P4_Limb *t, *sa, *sb, *z1;
+
+	if (nb < P4_BIG_KARATSUBA) {
+		p4MagMulSchool(r, a, na, b, nb);
+		return;
+	}
+	if (2 * nb <= na) {
+		/* Unbalanced; multiply b by each nb limb slice of a. */
+		if ((t = malloc(2 * nb * sizeof (*t))) == NULL) {
+			p4MagMulSchool(r, a, na, b, nb);
+			return;
+		}
+		(void) memset(r, 0, (na + nb) * sizeof (*r));
+		for (i = 0; i < na; i += nb) {
+			if ((c = na - i) < nb) {
+				p4MagMul(t, b, nb, a + i, c);
+			} else {
+				p4MagMul(t, a + i, c = nb, b, nb);
+			}
+			(void) p4MagAdd(r + i, r + i, na + nb - i, t, c + nb);
+		}
+		free(t);
+		return;
+	}
+
+	h = na / 2;
+	lsa = na - h + 1;
+	lsb = (h < nb - h ? nb - h : h) + 1;
+	if ((t = malloc(2 * (lsa + lsb) * sizeof (*t))) == NULL) {
+		p4MagMulSchool(r, a, na, b, nb);
+		return;
+	}
+	sa = t;
+	sb = sa + lsa;
+	z1 = sb + lsb;
+
+	sa[lsa-1] = p4MagAdd(sa, a + h, na - h, a, h);
+	if (h <= nb - h) {
+		sb[lsb-1] = p4MagAdd(sb, b + h, nb - h, b, h);
+	} else {
+		sb[lsb-1] = p4MagAdd(sb, b, h, b + h, nb - h);
+	}
+	p4MagMul(r, a, h, b, h);
+	p4MagMul(r + 2*h, a + h, na - h, b + h, nb - h);
+	if (lsb <= lsa) {
+		p4MagMul(z1, sa, lsa, sb, lsb);
+	} else {
+		p4MagMul(z1, sb, lsb, sa, lsa);
+	}
+	nz = lsa + lsb;
+	(void) p4MagSub(z1, z1, nz, r, 2*h);
+	(void) p4MagSub(z1, z1, nz, r + 2*h, na + nb - 2*h);
+	nz = p4MagNorm(z1, nz);
+	(void) p4MagAdd(r + h, r + h, na + nb - h, z1, nz);
+	free(t);
+}
+
+/* a /= d, return the remainder. */
+static P4_Limb
+p4MagDivLimb(P4_Limb *a, size_t n, P4_Limb d)
+{
+	P4_Limb2 t;
+	P4_Limb rem = 0;
+	while (0 < n--) {
+		t = (P4_Limb2) rem << P4_LIMB_BITS | a[n];
+		a[n] = (P4_Limb) (t / d);
+		rem = (P4_Limb) (t % d);
+	}
+	return rem;
+}
+
+/* a = a * m + c */
+static P4_Limb
+p4MagMulLimb(P4_Limb *a, size_t n, P4_Limb m, P4_Limb c)
+{
+	P4_Limb2 t;
+	for (size_t i = 0; i < n; i++) {
+		t = (P4_Limb2) a[i] * m + c;
+		a[i] = (P4_Limb) t;
+		c = (P4_Limb) (t >> P4_LIMB_BITS);
+	}
+	return c;
+}
+
+static int
+p4LimbClz(P4_Limb x)
+{
+	int n = 0;
+	for (P4_Limb top = (P4_Limb) 1 << (P4_LIMB_BITS - 1); (x & top) == 0; x <<= 1) {
+		n++;
+	}
+	return n;
+}
+
+/* r[0, n) = a << s, 0 <= s < P4_LIMB_BITS; return the bits shifted out. */
+static P4_Limb
+p4MagShl(P4_Limb *r, const P4_Limb *a, size_t n, int s)
+{
+	P4_Limb out = 0;
+	for (size_t i = 0; i < n; i++) {
+		P4_Limb x = a[i];
+		r[i] = x << s | out;
+		out = s == 0 ? 0 : x >> (P4_LIMB_BITS - s);
+	}
+	return out;
+}
+
+/*
+ * q[0, na-nb+1) = a / b, r[0, nb) = a % b, where nb <= na, b is
+ * normalised, and work has na+nb+1 limbs; Knuth vol. 2, 4.3.1 D.
+ */
+static void
+p4MagDivMod(P4_Limb *q, P4_Limb *r, const P4_Limb *a, size_t na, const P4_Limb *b, size_t nb, P4_Limb *work)
+{
+	int s;
+	size_t i, j;
+	P4_Limb2 num, qhat, rhat, p;
+	P4_Limb x, d, carry, borrow, *an, *bn;
+
+	if (nb == 1) {
+		(void) memcpy(q, a, na * sizeof (*q));
+		r[0] = p4MagDivLimb(q, na, b[0]);
+		return;
+	}
+
+	/* Normalise so the top bit of the divisor is set. */
+	s = p4LimbClz(b[nb-1]);
+	an = work;
+	bn = work + na + 1;
+	(void) p4MagShl(bn, b, nb, s);
+	an[na] = p4MagShl(an, a, na, s);
+
+	for (j = na - nb + 1; 0 < j--; ) {
+		num = (P4_Limb2) an[j+nb] << P4_LIMB_BITS | an[j+nb-1];
+		qhat = num / bn[nb-1];
+		rhat = num % bn[nb-1];
+		while (qhat >> P4_LIMB_BITS != 0
+		|| qhat * bn[nb-2] > (rhat << P4_LIMB_BITS | an[j+nb-2])) {
+			qhat--;
+			rhat += bn[nb-1];
+			if (rhat >> P4_LIMB_BITS != 0) {
+				break;
+			}
+		}
+
+		/* an[j, j+nb] -= qhat * bn */
+		carry = borrow = 0;
+		for (i = 0; i < nb; i++) {
+			p = qhat * bn[i] + carry;
+			carry = (P4_Limb) (p >> P4_LIMB_BITS);
+			x = an[i+j];
+			d = x - (P4_Limb) p;
+			x = x < (P4_Limb) p;
+			an[i+j] = d - borrow;
+			borrow = x | (d < borrow);
+		}
+		x = an[j+nb];
+		d = x - carry;
+		x = x < carry;
+		an[j+nb] = d - borrow;
+		borrow = x | (d < borrow);
+
+		/* Rarely qhat is one too large; add back. */
+		if (borrow != 0) {
+			qhat--;
+			an[j+nb] += p4MagAdd(an + j, an + j, nb, bn, nb);
+		}
+		q[j] = (P4_Limb) qhat;
+	}
+
+	/* Unnormalise the remainder. */
+	for (i = 0; i < nb; i++) {
+		r[i] = s == 0 ? an[i] : an[i] >> s | (i + 1 < nb ? an[i+1] << (P4_LIMB_BITS - s) : 0);
+	}
+}
+
+/***********************************************************************
+ *** Signed numbers
+ ***********************************************************************/
+
+static P4_Limb *
+p4BigAlloc(P4_Ctx *ctx, size_t n)
+{
+	P4_Limb *limb;
+	/* Always allocate something, so that NULL means failure. */
+	if ((limb = malloc((n + 1) * sizeof (*limb))) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	return limb;
+}
+
+/* Replace the magnitude of x with limb, which x now owns. */
+static void
+p4BigAssign(P4_Bignum *x, P4_Limb *limb, size_t n, int neg)
+{
+	free(x->limb);
+	x->limb = limb;
+	x->length = p4MagNorm(limb, n);
+	x->neg = x->length == 0 ? 0 : neg;
+}
+
+static void
+p4BigSetInt(P4_Ctx *ctx, P4_Bignum *x, P4_Int n)
+{
+	size_t i;
+	P4_Limb *limb = p4BigAlloc(ctx, (P4_UINT_BITS + P4_LIMB_BITS - 1) / P4_LIMB_BITS);
+	P4_Uint u = n < 0 ? -(P4_Uint) n : (P4_Uint) n;
+
+	for (i = 0; u != 0; i++) {
+		limb[i] = (P4_Limb) u;
+		/* Two shifts avoid undefined behaviour when a limb is a cell. */
+		u >>= P4_LIMB_BITS / 2;
+		u >>= P4_LIMB_BITS / 2;
+	}
+	p4BigAssign(x, limb, i, n < 0);
+}
+
+static P4_Bignum *
+p4BigPop(P4_Ctx *ctx)
+{
+	P4_Bignum *x = P4_POP(ctx->ds).v;
+	if (x == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_SIGSEGV);
+	}
+	return x;
+}
+
+/* r = a + b when neg is 0; r = a - b when neg is 1. */
+static void
+p4BigAddSub(P4_Ctx *ctx, P4_Bignum *r, const P4_Bignum *a, const P4_Bignum *b, int neg)
+{
+	P4_Limb *limb;
+	int bneg = b->neg ^ neg;
+	size_t n = a->length < b->length ? b->length : a->length;
+
+	limb = p4BigAlloc(ctx, n + 1);
+	if (a->neg == bneg) {
+		if (b->length <= a->length) {
+			limb[n] = p4MagAdd(limb, a->limb, a->length, b->limb, b->length);
+		} else {
+			limb[n] = p4MagAdd(limb, b->limb, b->length, a->limb, a->length);
+		}
+		p4BigAssign(r, limb, n + 1, a->neg);
+	} else if (0 <= p4MagCmp(a->limb, a->length, b->limb, b->length)) {
+		(void) p4MagSub(limb, a->limb, a->length, b->limb, b->length);
+		p4BigAssign(r, limb, a->length, a->neg);
+	} else {
+		(void) p4MagSub(limb, b->limb, b->length, a->limb, a->length);
+		p4BigAssign(r, limb, b->length, bneg);
+	}
+}
+
+static void
+p4BigMul(P4_Ctx *ctx, P4_Bignum *r, const P4_Bignum *a, const P4_Bignum *b)
+{
+	P4_Limb *limb = p4BigAlloc(ctx, a->length + b->length);
+	if (b->length <= a->length) {
+		p4MagMul(limb, a->limb, a->length, b->limb, b->length);
+	} else {
+		p4MagMul(limb, b->limb, b->length, a->limb, a->length);
+	}
+	p4BigAssign(r, limb, a->length + b->length, a->neg ^ b->neg);
+}
+
+/***********************************************************************
+ *** Words
+ ***********************************************************************/
+
+/*
+ * big-new ( n -- big )
+ */
+static void
+p4BigNew(P4_Ctx *ctx)
+{
+	P4_Bignum *x;
+	P4_Int n = P4_TOP(ctx->ds).n;
+	if ((x = calloc(1, sizeof (*x))) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	P4_TOP(ctx->ds).v = x;
+	p4BigSetInt(ctx, x, n);
+}
+
+/*
+ * big-free ( big -- )
+ */
+static void
+p4BigFree(P4_Ctx *ctx)
+{
+	P4_Bignum *x = P4_POP(ctx->ds).v;
+	if (x != NULL) {
+		free(x->string);
+		free(x->limb);
+		free(x);
+	}
+}
+
+/*
+ * big-set ( n big -- )
+ */
+static void
+p4BigSet(P4_Ctx *ctx)
+{
+	P4_Bignum *x = p4BigPop(ctx);
+	p4BigSetInt(ctx, x, P4_POP(ctx->ds).n);
+}
+
+/*
+ * big-cmp ( big1 big2 -- n )
+ */
+static void
+p4BigCmp(P4_Ctx *ctx)
+{
+	int cmp;
+	P4_Bignum *b = p4BigPop(ctx);
+	P4_Bignum *a = p4BigPop(ctx);
+	if (a->neg != b->neg) {
+		cmp = b->neg - a->neg;
+	} else {
+		cmp = p4MagCmp(a->limb, a->length, b->limb, b->length);
+		cmp = a->neg ? -cmp : cmp;
+	}
+	P4_PUSH(ctx->ds, (P4_Int) cmp);
+}
+
+/*
+ * big+ ( big1 big2 big3 -- )
+ */
+static void
+p4BigAddHook(P4_Ctx *ctx)
+{
+	P4_Bignum *r = p4BigPop(ctx);
+	P4_Bignum *b = p4BigPop(ctx);
+	p4BigAddSub(ctx, r, p4BigPop(ctx), b, 0);
+}
+
+/*
+ * big- ( big1 big2 big3 -- )
+ */
+static void
+p4BigSubHook(P4_Ctx *ctx)
+{
+	P4_Bignum *r = p4BigPop(ctx);
+	P4_Bignum *b = p4BigPop(ctx);
+	p4BigAddSub(ctx, r, p4BigPop(ctx), b, 1);
+}
+
+/*
+ * big* ( big1 big2 big3 -- )
+ */
+static void
+p4BigMulHook(P4_Ctx *ctx)
+{
+	P4_Bignum *r = p4BigPop(ctx);
+	P4_Bignum *b = p4BigPop(ctx);
+	p4BigMul(ctx, r, p4BigPop(ctx), b);
+}
+
+/*
+ * big/mod ( big1 big2 big3 big4 -- )
+ */
+static void
+p4BigDivModHook(P4_Ctx *ctx)
+{
+	int neg;
+	size_t na, nb;
+	P4_Limb *q, *r;
+	P4_Bignum *quot = p4BigPop(ctx);
+	P4_Bignum *rem = p4BigPop(ctx);
+	P4_Bignum *b = p4BigPop(ctx);
+	P4_Bignum *a = p4BigPop(ctx);
+
+	if ((nb = b->length) == 0) {
+		LONGJMP(ctx->longjmp, P4_THROW_DIV_ZERO);
+	}
+	if ((na = a->length) < nb) {
+		/* Copy before assigning, since rem might be a. */
+		r = p4BigAlloc(ctx, na);
+		(void) memcpy(r, a->limb, na * sizeof (*r));
+		neg = a->neg;
+		p4BigAssign(quot, p4BigAlloc(ctx, 0), 0, 0);
+		p4BigAssign(rem, r, na, neg);
+		return;
+	}
+	q = p4BigAlloc(ctx, na - nb + 1);
+	if ((r = malloc((nb + na + nb + 1) * sizeof (*r))) == NULL) {
+		free(q);
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	p4MagDivMod(q, r, a->limb, na, b->limb, nb, r + nb);
+	neg = a->neg;
+	p4BigAssign(quot, q, na - nb + 1, a->neg ^ b->neg);
+	p4BigAssign(rem, r, nb, neg);
+}
+
+/*
+ * big-powmod ( big1 big2 big3 big4 -- )
+ */
+static void
+p4BigPowModHook(P4_Ctx *ctx)
+{
+	size_t n, nm, nx, bit;
+	P4_Limb *buf, *base, *acc, *prod, *quot, *work, *tmp;
+	P4_Bignum *r = p4BigPop(ctx);
+	P4_Bignum *m = p4BigPop(ctx);
+	P4_Bignum *e = p4BigPop(ctx);
+	P4_Bignum *b = p4BigPop(ctx);
+
+	if ((nm = m->length) == 0) {
+		LONGJMP(ctx->longjmp, P4_THROW_DIV_ZERO);
+	}
+	if (e->neg) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+	}
+	/* base, acc, prod, quot, work */
+	buf = p4BigAlloc(ctx, nm + nm + 2*nm + 2*nm + (2*nm + nm + 1));
+	base = buf;
+	acc = base + nm;
+	prod = acc + nm;
+	quot = prod + 2*nm;
+	work = quot + 2*nm;
+
+	/* base = |b| mod m, then made positive. */
+	(void) memset(base, 0, nm * sizeof (*base));
+	if (nm <= b->length) {
+		n = b->length;
+		if ((tmp = malloc((n - nm + 1 + n + nm + 1) * sizeof (*tmp))) == NULL) {
+			free(buf);
+			LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+		}
+		p4MagDivMod(tmp, base, b->limb, n, m->limb, nm, tmp + n - nm + 1);
+		free(tmp);
+	} else {
+		(void) memcpy(base, b->limb, b->length * sizeof (*base));
+	}
+	if (b->neg && p4MagNorm(base, nm) != 0) {
+		(void) p4MagSub(base, m->limb, nm, base, nm);
+	}
+
+	/* acc = 1 mod m */
+	(void) memset(acc, 0, nm * sizeof (*acc));
+	acc[0] = nm == 1 && m->limb[0] == 1 ? 0 : 1;
+
+	/* Left to right square and multiply. */
+	for (bit = e->length * P4_LIMB_BITS; 0 < bit--; ) {
+		if ((nx = p4MagNorm(acc, nm)) != 0) {
+			p4MagMul(prod, acc, nx, acc, nx);
+			(void) memset(prod + 2*nx, 0, (2*nm - 2*nx) * sizeof (*prod));
+			p4MagDivMod(quot, acc, prod, 2*nm, m->limb, nm, work);
+		}
+		if (e->limb[bit / P4_LIMB_BITS] >> (bit % P4_LIMB_BITS) & 1) {
+			p4MagMul(prod, acc, nm, base, nm);
+			p4MagDivMod(quot, acc, prod, 2*nm, m->limb, nm, work);
+		}
+	}
+	(void) memmove(buf, acc, nm * sizeof (*buf));
+	p4BigAssign(r, buf, nm, 0);
+}
+
+static const char p4_big_digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+/*
+ * big>string ( big base -- caddr u )
+ */
+static void
+p4BigToString(P4_Ctx *ctx)
+{
+	char *s, *t;
+	int k, digits;
+	P4_Limb chunk, rem, *a;
+	P4_Uint base = P4_POP(ctx->ds).u;
+	P4_Bignum *x = P4_TOP(ctx->ds).v;
+	size_t n;
+
+	if (x == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_SIGSEGV);
+	}
+	if (base < 2 || 36 < base) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_BASE);
+	}
+	/* Largest power of the base in a limb; convert that many digits
+	 * for each division of the whole number.
+	 */
+	for (chunk = base, digits = 1; chunk <= ((P4_Limb) ~0) / base; digits++) {
+		chunk *= base;
+	}
+	n = x->length;
+	a = p4BigAlloc(ctx, n);
+	if ((s = realloc(x->string, n * P4_LIMB_BITS + 3)) == NULL) {
+		free(a);
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	x->string = s;
+	(void) memcpy(a, x->limb, n * sizeof (*a));
+
+	/* Least significant digit first, reversed afterwards. */
+	t = s;
+	do {
+		rem = p4MagDivLimb(a, n, chunk);
+		n = p4MagNorm(a, n);
+		for (k = 0; k < digits && (0 < n || 0 < rem || k == 0); k++) {
+			*t++ = p4_big_digits[rem % base];
+			rem /= base;
+		}
+	} while (0 < n);
+	free(a);
+	if (x->neg) {
+		*t++ = '-';
+	}
+	*t = '\0';
+	for (char *u = t; s < --u; s++) {
+		char c = *s;
+		*s = *u;
+		*u = c;
+	}
+	P4_TOP(ctx->ds).s = x->string;
+	P4_PUSH(ctx->ds, (P4_Size) (t - x->string));
+}
+
+/*
+ * string>big ( caddr u base big -- flag )
+ */
+static void
+p4StringToBig(P4_Ctx *ctx)
+{
+	int digit, neg = 0;
+	size_t i, n = 0;
+	P4_Limb *limb, carry;
+	P4_Bignum *x = p4BigPop(ctx);
+	P4_Uint base = P4_POP(ctx->ds).u;
+	size_t length = P4_POP(ctx->ds).z;
+	const char *s = P4_TOP(ctx->ds).s;
+
+	if (base < 2 || 36 < base) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_BASE);
+	}
+	if (0 < length && (*s == '-' || *s == '+')) {
+		neg = *s++ == '-';
+		length--;
+	}
+	P4_TOP(ctx->ds).n = P4_FALSE;
+	if (length == 0) {
+		return;
+	}
+	/* Each digit takes at most 6 bits. */
+	limb = p4BigAlloc(ctx, length * 6 / P4_LIMB_BITS + 1);
+	for (i = 0; i < length; i++) {
+		digit = isdigit((unsigned char) s[i]) ? s[i] - '0'
+			: isalpha((unsigned char) s[i]) ? tolower((unsigned char) s[i]) - 'a' + 10
+			: 36;
+		if (base <= (P4_Uint) digit) {
+			free(limb);
+			return;
+		}
+		if ((carry = p4MagMulLimb(limb, n, (P4_Limb) base, (P4_Limb) digit)) != 0) {
+			limb[n++] = carry;
+		}
+	}
+	p4BigAssign(x, limb, n, neg);
+	P4_TOP(ctx->ds).n = P4_TRUE;
+}
+
+P4_Hook p4_bignum_hooks[] = {
+	P4_HOOK(0x11, "big-new", p4BigNew),
+	P4_HOOK(0x10, "big-free", p4BigFree),
+	P4_HOOK(0x20, "big-set", p4BigSet),
+	P4_HOOK(0x21, "big-cmp", p4BigCmp),
+	P4_HOOK(0x30, "big+", p4BigAddHook),
+	P4_HOOK(0x30, "big-", p4BigSubHook),
+	P4_HOOK(0x30, "big*", p4BigMulHook),
+	P4_HOOK(0x40, "big/mod", p4BigDivModHook),
+	P4_HOOK(0x40, "big-powmod", p4BigPowModHook),
+	P4_HOOK(0x22, "big>string", p4BigToString),
+	P4_HOOK(0x41, "string>big", p4StringToBig),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
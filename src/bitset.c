@@ -0,0 +1,309 @@
+/*
+ * bitset.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+/*
+ * A bitset is allocated by ALLOCATE, so FREE releases it.  The size
+ * in bits is followed by the bits packed into cells, least significant
+ * bit first.  Bits beyond the size are always zero.
+ */
+typedef struct {
+	P4_Size		bits;
+	P4_Uint		words[];
+} P4_Bitset;
+
+#define P4_BITSET_WORDS(n)	(((n) + P4_UINT_BITS - 1) / P4_UINT_BITS)
+
+static unsigned
+p4PopCount(P4_Uint x)
+{
+#ifdef __GNUC__
+	return (unsigned) __builtin_popcountll(x);
+#else
+	x -= (x >> 1) & (P4_Uint)0x5555555555555555L;
+	x = ((x >> 2) & (P4_Uint)0x3333333333333333L) + (x & (P4_Uint)0x3333333333333333L);
+	x = ((x >> 4) + x) & (P4_Uint)0x0f0f0f0f0f0f0f0fL;
+	return (unsigned) ((x * (P4_Uint)0x0101010101010101L) >> (P4_UINT_BITS - 8));
+#endif
+}
+
+static unsigned
+p4TrailZeroBits(P4_Uint x)
+{
+	if (x == 0) {
+		return P4_UINT_BITS;
+	}
+#ifdef __GNUC__
+	return (unsigned) __builtin_ctzll(x);
+#else
+	/* Isolate the lowest set bit and count the ones below it. */
+	return p4PopCount((x & -x) - 1);
+#endif
+}
+
+static P4_Bitset *
+p4BitsetPop(P4_Ctx *ctx)
+{
+	P4_Bitset *bs = P4_POP(ctx->ds).v;
+	if (bs == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_SIGSEGV);
+	}
+	return bs;
+}
+
+/* Pop ( u bs ) and check u is a valid bit index. */
+static P4_Bitset *
+p4BitsetIndex(P4_Ctx *ctx, P4_Size *index)
+{
+	P4_Bitset *bs = p4BitsetPop(ctx);
+	*index = P4_POP(ctx->ds).z;
+	if (bs->bits <= *index) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+	}
+	return bs;
+}
+
+/*
+ * bitset-new ( u -- bs )
+ */
+static void
+p4BitsetNew(P4_Ctx *ctx)
+{
+	size_t size;
+	P4_Bitset *bs;
+	P4_Size bits = P4_TOP(ctx->ds).z;
+
+	/* Rounding up to whole cells or the size in bytes would wrap. */
+	if (SIZE_MAX - (P4_UINT_BITS - 1) < bits
+	|| (SIZE_MAX - sizeof (*bs)) / sizeof (P4_Uint) < P4_BITSET_WORDS(bits)) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+	}
+	size = sizeof (*bs) + P4_BITSET_WORDS(bits) * sizeof (P4_Uint);
+	if ((bs = p4HeapRealloc(NULL, size)) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	(void) memset(bs, 0, size);
+	bs->bits = bits;
+	P4_TOP(ctx->ds).v = bs;
+}
+
+/*
+ * bit-set ( u bs -- )
+ */
+static void
+p4BitSet(P4_Ctx *ctx)
+{
+	P4_Size i;
+	P4_Bitset *bs = p4BitsetIndex(ctx, &i);
+	bs->words[i / P4_UINT_BITS] |= (P4_Uint) 1 << (i % P4_UINT_BITS);
+}
+
+/*
+ * bit-clear ( u bs -- )
+ */
+static void
+p4BitClear(P4_Ctx *ctx)
+{
+	P4_Size i;
+	P4_Bitset *bs = p4BitsetIndex(ctx, &i);
+	bs->words[i / P4_UINT_BITS] &= ~((P4_Uint) 1 << (i % P4_UINT_BITS));
+}
+
+/*
+ * bit? ( u bs -- flag )
+ */
+static void
+p4BitTest(P4_Ctx *ctx)
+{
+	P4_Size i;
+	P4_Bitset *bs = p4BitsetIndex(ctx, &i);
+	P4_PUSH(ctx->ds, (P4_Int) -((bs->words[i / P4_UINT_BITS] >> (i % P4_UINT_BITS)) & 1));
+}
+
+/*
+ * bitset-count ( bs -- u )
+ */
+static void
+p4BitsetCount(P4_Ctx *ctx)
+{
+	P4_Bitset *bs = P4_TOP(ctx->ds).v;
+	size_t i, n = P4_BITSET_WORDS(bs->bits);
+	P4_Uint c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+
+	/* Independent sums so the compiler can pipeline or vectorise. */
+	for (i = 0; i + 4 <= n; i += 4) {
+		c0 += p4PopCount(bs->words[i]);
+		c1 += p4PopCount(bs->words[i+1]);
+		c2 += p4PopCount(bs->words[i+2]);
+		c3 += p4PopCount(bs->words[i+3]);
+	}
+	for ( ; i < n; i++) {
+		c0 += p4PopCount(bs->words[i]);
+	}
+	P4_TOP(ctx->ds).u = c0 + c1 + c2 + c3;
+}
+
+typedef enum { P4_BITS_AND, P4_BITS_OR, P4_BITS_XOR, P4_BITS_ANDNOT } P4_Bits_Op;
+
+/*
+ * ( bs2 bs1 -- ) bs1 := bs1 op bs2
+ *
+ * Sets of different sizes treat the missing bits of the shorter set as
+ * zero; the size of bs1 is unchanged.
+ */
+static void
+p4BitsetOp(P4_Ctx *ctx, P4_Bits_Op op)
+{
+	P4_Bitset *dst = p4BitsetPop(ctx);
+	P4_Bitset *src = p4BitsetPop(ctx);
+	size_t i, nd = P4_BITSET_WORDS(dst->bits);
+	size_t n = P4_BITSET_WORDS(src->bits);
+	P4_Uint *d = dst->words, *s = src->words;
+
+	if (nd < n) {
+		n = nd;
+	}
+	switch (op) {
+	case P4_BITS_AND:
+		for (i = 0; i < n; i++) {
+			d[i] &= s[i];
+		}
+		for ( ; i < nd; i++) {
+			d[i] = 0;
+		}
+		break;
+	case P4_BITS_OR:
+		for (i = 0; i < n; i++) {
+			d[i] |= s[i];
+		}
+		break;
+	case P4_BITS_XOR:
+		for (i = 0; i < n; i++) {
+			d[i] ^= s[i];
+		}
+		break;
+	case P4_BITS_ANDNOT:
+		for (i = 0; i < n; i++) {
+			d[i] &= ~s[i];
+		}
+		break;
+	}
+	/* Keep the bits beyond the size of bs1 clear. */
+	if (0 < nd && dst->bits % P4_UINT_BITS != 0) {
+		d[nd - 1] &= ((P4_Uint) 1 << (dst->bits % P4_UINT_BITS)) - 1;
+	}
+}
+
+/*
+ * bitset-and ( bs2 bs1 -- )
+ */
+static void
+p4BitsetAnd(P4_Ctx *ctx)
+{
+	p4BitsetOp(ctx, P4_BITS_AND);
+}
+
+/*
+ * bitset-or ( bs2 bs1 -- )
+ */
+static void
+p4BitsetOr(P4_Ctx *ctx)
+{
+	p4BitsetOp(ctx, P4_BITS_OR);
+}
+
+/*
+ * bitset-xor ( bs2 bs1 -- )
+ */
+static void
+p4BitsetXor(P4_Ctx *ctx)
+{
+	p4BitsetOp(ctx, P4_BITS_XOR);
+}
+
+/*
+ * bitset-andnot ( bs2 bs1 -- )
+ */
+static void
+p4BitsetAndNot(P4_Ctx *ctx)
+{
+	p4BitsetOp(ctx, P4_BITS_ANDNOT);
+}
+
+/*
+ * next-set-bit ( u1 bs -- u2 | -1 )
+ */
+static void
+p4NextSetBit(P4_Ctx *ctx)
+{
+	P4_Bitset *bs = p4BitsetPop(ctx);
+	P4_Size i = P4_TOP(ctx->ds).z;
+	size_t w, n = P4_BITSET_WORDS(bs->bits);
+	P4_Uint bits;
+
+	P4_TOP(ctx->ds).n = -1;
+	if (bs->bits <= i) {
+		return;
+	}
+	w = i / P4_UINT_BITS;
+	bits = bs->words[w] & (~(P4_Uint) 0 << (i % P4_UINT_BITS));
+	while (bits == 0) {
+		if (n <= ++w) {
+			return;
+		}
+		bits = bs->words[w];
+	}
+	P4_TOP(ctx->ds).u = w * P4_UINT_BITS + p4TrailZeroBits(bits);
+}
+
+/*
+ * popcount ( x -- u )
+ */
+static void
+p4PopCountHook(P4_Ctx *ctx)
+{
+	P4_TOP(ctx->ds).u = p4PopCount(P4_TOP(ctx->ds).u);
+}
+
+/*
+ * clz ( x -- u )
+ */
+static void
+p4Clz(P4_Ctx *ctx)
+{
+	P4_TOP(ctx->ds).u = p4LeadZeroBits(P4_TOP(ctx->ds).u);
+}
+
+/*
+ * ctz ( x -- u )
+ */
+static void
+p4Ctz(P4_Ctx *ctx)
+{
+	P4_TOP(ctx->ds).u = p4TrailZeroBits(P4_TOP(ctx->ds).u);
+}
+
+P4_Hook p4_bitset_hooks[] = {
+	P4_HOOK(0x11, "bitset-new", p4BitsetNew),
+	P4_HOOK(0x20, "bit-set", p4BitSet),
+	P4_HOOK(0x20, "bit-clear", p4BitClear),
+	P4_HOOK(0x21, "bit?", p4BitTest),
+	P4_HOOK(0x11, "bitset-count", p4BitsetCount),
+	P4_HOOK(0x20, "bitset-and", p4BitsetAnd),
+	P4_HOOK(0x20, "bitset-or", p4BitsetOr),
+	P4_HOOK(0x20, "bitset-xor", p4BitsetXor),
+	P4_HOOK(0x20, "bitset-andnot", p4BitsetAndNot),
+	P4_HOOK(0x21, "next-set-bit", p4NextSetBit),
+	P4_HOOK(0x11, "popcount", p4PopCountHook),
+	P4_HOOK(0x11, "clz", p4Clz),
+	P4_HOOK(0x11, "ctz", p4Ctz),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
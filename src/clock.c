@@ -0,0 +1,114 @@
+/*
+ * clock.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+uint64_t
+p4ClockNs(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return (uint64_t) clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
+}
+
+/*
+ * Process CPU time, all threads, in nanoseconds.
+ */
+static uint64_t
+p4CpuNs(void)
+{
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+	struct timespec ts;
+	(void) clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return (uint64_t) clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
+}
+
+/*
+ * The CPU time stamp or virtual counter, whose rate depends on the
+ * hardware; otherwise fall back to nanoseconds.
+ */
+static uint64_t
+p4Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t cnt;
+	__asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (cnt));
+	return cnt;
+#else
+	return p4ClockNs();
+#endif
+}
+
+#ifdef HAVE_HOOKS
+
+/* Push a 64-bit count as a double cell. */
+static void
+p4PushUd(P4_Ctx *ctx, uint64_t ud)
+{
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, (P4_Uint) ud);
+	/* Two shifts avoid undefined behaviour when cells are 64 bits. */
+	P4_PUSH(ctx->ds, (P4_Uint) (ud >> (P4_UINT_BITS - 1) >> 1));
+}
+
+/*
+ * ntime ( -- ud )
+ */
+static void
+p4NTime(P4_Ctx *ctx)
+{
+	p4PushUd(ctx, p4ClockNs());
+}
+
+/*
+ * utime ( -- ud )
+ */
+static void
+p4UTime(P4_Ctx *ctx)
+{
+	p4PushUd(ctx, p4ClockNs() / 1000);
+}
+
+/*
+ * cputime ( -- ud )
+ */
+static void
+p4CpuTime(P4_Ctx *ctx)
+{
+	p4PushUd(ctx, p4CpuNs());
+}
+
+/*
+ * cycles ( -- ud )
+ */
+static void
+p4CyclesHook(P4_Ctx *ctx)
+{
+	p4PushUd(ctx, p4Cycles());
+}
+
+P4_Hook p4_clock_hooks[] = {
+	P4_HOOK(0x02, "ntime", p4NTime),
+	P4_HOOK(0x02, "utime", p4UTime),
+	P4_HOOK(0x02, "cputime", p4CpuTime),
+	P4_HOOK(0x02, "cycles", p4CyclesHook),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
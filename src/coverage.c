@@ -0,0 +1,453 @@
+/*
+ * coverage.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+/*
+ * Coverage keeps a byte of flags per cell of data space: executed,
+ * and for _branchz and _branchnz, the directions taken.  While on,
+ * each cell allotted from a file also notes the file and line, so
+ * words INCLUDED after COVERAGE-ON can be reported in lcov format.
+ */
+#define P4_COVER_RUN		0x01
+#define P4_COVER_TAKEN		0x02
+#define P4_COVER_FELL		0x04
+
+typedef struct {
+	int		on;
+	P4_Cell *	base;		/* Start of data space. */
+	size_t		ncells;
+	uint8_t *	flags;
+	uint32_t *	line;		/* Source line per cell. */
+	uint16_t *	file;		/* Index into files plus 1, 0 unknown. */
+	size_t		nfiles;
+	char **		files;
+	P4_Xt		branchz;
+	P4_Xt		branchnz;
+	P4_Xt		slit;		/* A colon definition. */
+} P4_Cover;
+
+void
+p4CoverMark(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip, P4_Cell top)
+{
+	size_t i, n;
+	P4_Cover *cov = ctx->cover;
+
+	if (!cov->on || ip <= cov->base || cov->base + cov->ncells < ip) {
+		return;
+	}
+	i = ip - 1 - cov->base;
+	if (xt == cov->branchz || xt == cov->branchnz) {
+		cov->flags[i] |= (top.u == 0) == (xt == cov->branchz) ? P4_COVER_TAKEN : P4_COVER_FELL;
+	}
+	/* The literals following xt; a string is its length and text. */
+	if (xt == cov->slit) {
+		n = 2 + (ip->u + sizeof (P4_Cell)) / sizeof (P4_Cell);
+	} else {
+		n = 1 + P4_WD_LIT(xt);
+	}
+	for ( ; 0 < n && i < cov->ncells; n--) {
+		cov->flags[i++] |= P4_COVER_RUN;
+	}
+}
+
+static uint16_t
+p4CoverFile(P4_Cover *cov, const char *path)
+{
+	size_t i;
+	char **files;
+
+	/* Most recent first, usually the current file. */
+	for (i = cov->nfiles; 0 < i; i--) {
+		if (strcmp(cov->files[i-1], path) == 0) {
+			return i;
+		}
+	}
+	if (UINT16_MAX <= cov->nfiles
+	|| (files = realloc(cov->files, (cov->nfiles + 1) * sizeof (*files))) == NULL) {
+		return 0;
+	}
+	cov->files = files;
+	if ((files[cov->nfiles] = strdup(path)) == NULL) {
+		return 0;
+	}
+	return ++cov->nfiles;
+}
+
+void
+p4CoverAllot(P4_Ctx *ctx, void *start, P4_Int n)
+{
+	size_t i, end;
+	uint16_t file;
+	P4_Cover *cov = ctx->cover;
+
+	if (!cov->on || n <= 0 || !P4_INPUT_IS_FILE(ctx->input) || ctx->input->path == NULL) {
+		return;
+	}
+	i = ((P4_Char *) start - (P4_Char *) cov->base) / sizeof (P4_Cell);
+	end = ((P4_Char *) start + n - (P4_Char *) cov->base + sizeof (P4_Cell) - 1) / sizeof (P4_Cell);
+	if (cov->ncells < end) {
+		end = cov->ncells;
+	}
+	file = p4CoverFile(cov, ctx->input->path);
+	for ( ; i < end; i++) {
+		cov->file[i] = file;
+		cov->line[i] = ctx->input->line;
+		/* Space reused after FORGET or MARKER. */
+		cov->flags[i] = 0;
+	}
+}
+
+int
+p4CoverStart(P4_Ctx *ctx)
+{
+	P4_Cover *cov = ctx->cover;
+
+	if (cov == NULL) {
+		if ((cov = calloc(1, sizeof (*cov))) == NULL) {
+			return -1;
+		}
+		cov->base = (P4_Cell *) (ctx + 1);
+		cov->ncells = ((P4_Char *) ctx->end - (P4_Char *) cov->base) / sizeof (P4_Cell);
+		if ((cov->flags = calloc(cov->ncells, sizeof (*cov->flags))) == NULL
+		|| (cov->line = calloc(cov->ncells, sizeof (*cov->line))) == NULL
+		|| (cov->file = calloc(cov->ncells, sizeof (*cov->file))) == NULL) {
+			free(cov->flags);
+			free(cov->line);
+			free(cov);
+			return -1;
+		}
+		cov->branchz = p4FindName(ctx, "_branchz", STRLEN("_branchz"));
+		cov->branchnz = p4FindName(ctx, "_branchnz", STRLEN("_branchnz"));
+		cov->slit = p4FindName(ctx, "slit", STRLEN("slit"));
+		ctx->cover = cov;
+	}
+	cov->on = 1;
+	p4TraceHooks(ctx);
+	return 0;
+}
+
+void
+p4CoverStop(P4_Ctx *ctx)
+{
+	P4_Cover *cov = ctx->cover;
+
+	if (cov != NULL) {
+		cov->on = 0;
+	}
+	p4TraceHooks(ctx);
+}
+
+int
+p4Covering(P4_Ctx *ctx)
+{
+	P4_Cover *cov = ctx->cover;
+	return cov != NULL && cov->on;
+}
+
+void
+p4CoverFree(P4_Ctx *ctx)
+{
+	P4_Cover *cov = ctx->cover;
+
+	if (cov != NULL) {
+		for (size_t i = 0; i < cov->nfiles; i++) {
+			free(cov->files[i]);
+		}
+		free(cov->files);
+		free(cov->flags);
+		free(cov->line);
+		free(cov->file);
+		free(cov);
+		ctx->cover = NULL;
+	}
+	p4TraceHooks(ctx);
+}
+
+typedef struct {
+	size_t		cells;
+	size_t		run;
+	size_t		branches;	/* Directions, two per branch. */
+	size_t		taken;
+} P4_Cover_Count;
+
+static int
+p4CoverIsColon(const P4_Cover *cov, const P4_Word *word)
+{
+	return cov->slit != NULL && word->code == cov->slit->code
+	    && word->data != NULL && 0 < word->ndata
+	    && cov->base <= word->data && word->data < cov->base + cov->ncells;
+}
+
+static void
+p4CoverCount(const P4_Cover *cov, const P4_Word *word, P4_Cover_Count *count)
+{
+	size_t i = word->data - cov->base;
+	size_t end = i + word->ndata / sizeof (P4_Cell);
+
+	(void) memset(count, 0, sizeof (*count));
+	for ( ; i < end && i < cov->ncells; i++) {
+		count->cells++;
+		count->run += (cov->flags[i] & P4_COVER_RUN) != 0;
+		if (cov->base[i].xt == cov->branchz || cov->base[i].xt == cov->branchnz) {
+			count->branches += 2;
+			count->taken += ((cov->flags[i] & P4_COVER_TAKEN) != 0) + ((cov->flags[i] & P4_COVER_FELL) != 0);
+		}
+	}
+}
+
+/* Colon definitions, oldest first, that ran or were defined from a file while on. */
+static size_t
+p4CoverWords(P4_Ctx *ctx, const P4_Cover *cov, P4_Word ***out)
+{
+	size_t n, count = 0;
+	P4_Word **words = NULL;
+
+	for (int pass = 0; pass < 2; pass++) {
+		n = 0;
+		for (int i = -1; i < P4_WORDLISTS; i++) {
+			for (P4_Word *word = ctx->lists[i]; word != NULL; word = word->prev) {
+				size_t at;
+				if (!p4CoverIsColon(cov, word)) {
+					continue;
+				}
+				at = word->data - cov->base;
+				if (cov->file[at] == 0 && (cov->flags[at] & P4_COVER_RUN) == 0) {
+					continue;
+				}
+				if (pass == 1) {
+					words[count - ++n] = word;
+				} else {
+					n++;
+				}
+			}
+		}
+		if (pass == 0) {
+			count = n;
+			if (count == 0 || (words = malloc(count * sizeof (*words))) == NULL) {
+				*out = NULL;
+				return 0;
+			}
+		}
+	}
+	*out = words;
+	return count;
+}
+
+static double
+p4CoverPercent(size_t n, size_t d)
+{
+	return d == 0 ? 100.0 : 100.0 * n / d;
+}
+
+void
+p4CoverReport(P4_Ctx *ctx, FILE *fp)
+{
+	size_t n, at;
+	P4_Word **words;
+	P4_Cover_Count count;
+	P4_Cover *cov = ctx->cover;
+
+	if (cov == NULL || (n = p4CoverWords(ctx, cov, &words)) == 0) {
+		return;
+	}
+	(void) fprintf(fp, "%-28s %13s %6s %11s %6s  %s" NL, "word", "cells", "%", "branches", "%", "source");
+	for (size_t i = 0; i < n; i++) {
+		p4CoverCount(cov, words[i], &count);
+		at = words[i]->data - cov->base;
+		(void) fprintf(fp, "%-28.*s %6zu/%-6zu %5.1f%% %5zu/%-5zu %5.1f%%  ",
+			0 < words[i]->length ? (int) words[i]->length : 7,
+			0 < words[i]->length ? words[i]->name : ":NONAME",
+			count.run, count.cells, p4CoverPercent(count.run, count.cells),
+			count.taken, count.branches, p4CoverPercent(count.taken, count.branches)
+		);
+		if (0 < cov->file[at]) {
+			(void) fprintf(fp, "%s:%u", cov->files[cov->file[at] - 1], (unsigned) cov->line[at]);
+		}
+		(void) fputs(newline, fp);
+	}
+	free(words);
+}
+
+typedef struct {
+	uint32_t	line;
+	uint8_t		run;
+} P4_Cover_Line;
+
+static int
+p4CoverByLine(const void *a, const void *b)
+{
+	const P4_Cover_Line *x = a, *y = b;
+	return (x->line > y->line) - (x->line < y->line);
+}
+
+/*
+ * Write an lcov tracefile record per source file: functions, line
+ * hits, and branch directions.  Counts are 0 or 1, not executions.
+ */
+int
+p4CoverLcov(P4_Ctx *ctx, FILE *fp)
+{
+	P4_Word **words;
+	P4_Cover_Line *lines;
+	size_t n, nlines, maxlines, at, end;
+	size_t fnf, fnh, brf, brh, lf, lh, block;
+	P4_Cover *cov = ctx->cover;
+
+	if (cov == NULL || (n = p4CoverWords(ctx, cov, &words)) == 0) {
+		return 0;
+	}
+	maxlines = 0;
+	for (size_t i = 0; i < n; i++) {
+		maxlines += words[i]->ndata / sizeof (P4_Cell);
+	}
+	if ((lines = malloc(maxlines * sizeof (*lines))) == NULL) {
+		free(words);
+		return -1;
+	}
+	(void) fputs("TN:" NL, fp);
+	for (uint16_t f = 1; f <= cov->nfiles; f++) {
+		(void) fprintf(fp, "SF:%s" NL, cov->files[f-1]);
+		fnf = fnh = brf = brh = nlines = 0;
+		for (size_t i = 0; i < n; i++) {
+			at = words[i]->data - cov->base;
+			if (cov->file[at] != f) {
+				continue;
+			}
+			(void) fprintf(fp, "FN:%u,%.*s" NL "FNDA:%d,%.*s" NL,
+				(unsigned) cov->line[at],
+				0 < words[i]->length ? (int) words[i]->length : 7,
+				0 < words[i]->length ? words[i]->name : ":NONAME",
+				(cov->flags[at] & P4_COVER_RUN) != 0,
+				0 < words[i]->length ? (int) words[i]->length : 7,
+				0 < words[i]->length ? words[i]->name : ":NONAME"
+			);
+			fnf++;
+			fnh += (cov->flags[at] & P4_COVER_RUN) != 0;
+			end = at + words[i]->ndata / sizeof (P4_Cell);
+			for (block = 0; at < end && at < cov->ncells; at++) {
+				if (cov->file[at] != f) {
+					continue;
+				}
+				lines[nlines].line = cov->line[at];
+				lines[nlines++].run = (cov->flags[at] & P4_COVER_RUN) != 0;
+				if (cov->base[at].xt != cov->branchz && cov->base[at].xt != cov->branchnz) {
+					continue;
+				}
+				if (cov->flags[at] & P4_COVER_RUN) {
+					(void) fprintf(fp, "BRDA:%u,%zu,0,%d" NL "BRDA:%u,%zu,1,%d" NL,
+						(unsigned) cov->line[at], block, (cov->flags[at] & P4_COVER_TAKEN) != 0,
+						(unsigned) cov->line[at], block, (cov->flags[at] & P4_COVER_FELL) != 0
+					);
+				} else {
+					(void) fprintf(fp, "BRDA:%u,%zu,0,-" NL "BRDA:%u,%zu,1,-" NL,
+						(unsigned) cov->line[at], block, (unsigned) cov->line[at], block
+					);
+				}
+				brf += 2;
+				brh += ((cov->flags[at] & P4_COVER_TAKEN) != 0) + ((cov->flags[at] & P4_COVER_FELL) != 0);
+				block++;
+			}
+		}
+		(void) fprintf(fp, "FNF:%zu" NL "FNH:%zu" NL "BRF:%zu" NL "BRH:%zu" NL, fnf, fnh, brf, brh);
+		/* A line is hit if any of its cells ran. */
+		qsort(lines, nlines, sizeof (*lines), p4CoverByLine);
+		lf = lh = 0;
+		for (size_t i = 0; i < nlines; ) {
+			uint8_t run = 0;
+			uint32_t line = lines[i].line;
+			for ( ; i < nlines && lines[i].line == line; i++) {
+				run |= lines[i].run;
+			}
+			(void) fprintf(fp, "DA:%u,%u" NL, (unsigned) line, (unsigned) run);
+			lf++;
+			lh += run;
+		}
+		(void) fprintf(fp, "LF:%zu" NL "LH:%zu" NL "end_of_record" NL, lf, lh);
+	}
+	free(lines);
+	free(words);
+	return 0;
+}
+
+#ifdef HAVE_HOOKS
+
+/*
+ * coverage-on ( -- )
+ */
+static void
+p4CoverOn(P4_Ctx *ctx)
+{
+	if (p4CoverStart(ctx)) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+}
+
+/*
+ * coverage-off ( -- )
+ */
+static void
+p4CoverOff(P4_Ctx *ctx)
+{
+	p4CoverStop(ctx);
+}
+
+/*
+ * coverage-reset ( -- )
+ */
+static void
+p4CoverReset(P4_Ctx *ctx)
+{
+	p4CoverFree(ctx);
+}
+
+/*
+ * coverage-report ( -- )
+ */
+static void
+p4CoverReportHook(P4_Ctx *ctx)
+{
+	(void) fflush(stdout);
+	p4CoverReport(ctx, stdout);
+}
+
+/*
+ * coverage-lcov ( caddr u -- ior )
+ */
+static void
+p4CoverLcovHook(P4_Ctx *ctx)
+{
+	FILE *fp;
+	int rc = -1;
+	char *path;
+	P4_Uint u = P4_POP(ctx->ds).u;
+
+	if ((path = strndup(P4_TOP(ctx->ds).s, u)) != NULL) {
+		if ((fp = fopen(path, "w")) != NULL) {
+			rc = p4CoverLcov(ctx, fp);
+			if (ferror(fp)) {
+				rc = -1;
+			}
+			if (fclose(fp) != 0) {
+				rc = -1;
+			}
+		}
+		free(path);
+	}
+	/* errno is only meaningful after a failed call. */
+	P4_TOP(ctx->ds).n = rc == 0 ? 0 : errno;
+}
+
+P4_Hook p4_cover_hooks[] = {
+	P4_HOOK(0x00, "coverage-on", p4CoverOn),
+	P4_HOOK(0x00, "coverage-off", p4CoverOff),
+	P4_HOOK(0x00, "coverage-reset", p4CoverReset),
+	P4_HOOK(0x00, "coverage-report", p4CoverReportHook),
+	P4_HOOK(0x21, "coverage-lcov", p4CoverLcovHook),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
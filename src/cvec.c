@@ -0,0 +1,352 @@
+/*
+ * cvec.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+/*
+ * Kernels over contiguous arrays of cells, see fvec.c.  Arithmetic is
+ * unsigned so that overflow wraps as with + and *; comparisons are
+ * signed.
+ */
+#ifdef __GNUC__
+# define P4_CV_VECTOR
+# define P4_CV_BYTES		32
+typedef P4_Uint P4_Cvec __attribute__((vector_size(P4_CV_BYTES)));
+typedef P4_Int P4_Cvec_s __attribute__((vector_size(P4_CV_BYTES)));
+# define P4_CV_LANES		(P4_CV_BYTES / sizeof (P4_Cell))
+#endif
+
+#if defined(P4_CV_VECTOR) && defined(__x86_64__) && defined(__GLIBC__) && defined(__has_attribute)
+# if __has_attribute(target_clones)
+#  define P4_CV_CLONES		__attribute__((target_clones("avx2", "default")))
+# endif
+#endif
+#ifndef P4_CV_CLONES
+# define P4_CV_CLONES
+#endif
+
+#ifdef P4_CV_VECTOR
+typedef P4_Uint P4_Cvec_u __attribute__((vector_size(P4_CV_BYTES), aligned(sizeof (P4_Cell)), may_alias));
+
+# define P4_CV_LOAD(p)		(*(const P4_Cvec_u *) (p))
+# define P4_CV_STORE(p, v)	(*(P4_Cvec_u *) (p) = (v))
+#endif
+
+#ifdef P4_CV_VECTOR
+# define P4_CV_BINARY_LOOP(OP) \
+	for ( ; i + P4_CV_LANES <= n; i += P4_CV_LANES) \
+		P4_CV_STORE(c + i, P4_CV_LOAD(a + i) OP P4_CV_LOAD(b + i))
+#else
+# define P4_CV_BINARY_LOOP(OP)
+#endif
+
+#define P4_CV_BINARY(fn, OP) \
+P4_CV_CLONES static void \
+fn(const P4_Uint *a, const P4_Uint *b, P4_Uint *c, size_t n) \
+{ \
+	size_t i = 0; \
+	P4_CV_BINARY_LOOP(OP); \
+	for ( ; i < n; i++) { \
+		c[i] = a[i] OP b[i]; \
+	} \
+}
+
+P4_CV_BINARY(p4CvAdd, +)
+P4_CV_BINARY(p4CvSub, -)
+P4_CV_BINARY(p4CvMul, *)
+
+P4_CV_CLONES static P4_Uint
+p4CvSum(const P4_Uint *x, size_t n)
+{
+	size_t i = 0;
+	P4_Uint sum = 0;
+#ifdef P4_CV_VECTOR
+	P4_Cvec acc = { 0 };
+	for ( ; i + P4_CV_LANES <= n; i += P4_CV_LANES) {
+		acc += P4_CV_LOAD(x + i);
+	}
+	for (size_t j = 0; j < P4_CV_LANES; j++) {
+		sum += acc[j];
+	}
+#endif
+	for ( ; i < n; i++) {
+		sum += x[i];
+	}
+	return sum;
+}
+
+/*
+ * Index of the first minimum, or of the first maximum when flip is -1,
+ * which reverses the signed order without overflow; -1 when empty.
+ * Each lane tracks its best value and index; the lanes are then merged
+ * preferring the lower index on ties.
+ */
+P4_CV_CLONES static P4_Int
+p4CvExtreme(const P4_Int *x, size_t n, P4_Int flip)
+{
+	size_t i = 0;
+	P4_Int m = 0, at = -1;
+#ifdef P4_CV_VECTOR
+	if (P4_CV_LANES <= n) {
+		P4_Cvec_s v, lt, best, index, where = { 0 };
+		for (size_t j = 0; j < P4_CV_LANES; j++) {
+			where[j] = j;
+		}
+		index = where;
+		best = (P4_Cvec_s) P4_CV_LOAD(x) ^ flip;
+		for (i = P4_CV_LANES; i + P4_CV_LANES <= n; i += P4_CV_LANES) {
+			index += (P4_Int) P4_CV_LANES;
+			v = (P4_Cvec_s) P4_CV_LOAD(x + i) ^ flip;
+			lt = v < best;
+			best = (lt & v) | (~lt & best);
+			where = (lt & index) | (~lt & where);
+		}
+		m = best[0];
+		at = where[0];
+		for (size_t j = 1; j < P4_CV_LANES; j++) {
+			if (best[j] < m || (best[j] == m && where[j] < at)) {
+				m = best[j];
+				at = where[j];
+			}
+		}
+	}
+#endif
+	for ( ; i < n; i++) {
+		if (at < 0 || (x[i] ^ flip) < m) {
+			m = x[i] ^ flip;
+			at = i;
+		}
+	}
+	return at;
+}
+
+/*
+ * Each sum depends on the previous one, so the scan is a scalar loop;
+ * at one add per cell it runs at memory speed.
+ */
+static void
+p4CvScan(const P4_Uint *x, P4_Uint *y, size_t n)
+{
+	P4_Uint sum = 0;
+	for (size_t i = 0; i < n; i++) {
+		y[i] = sum += x[i];
+	}
+}
+
+P4_CV_CLONES static void
+p4CvFill(P4_Uint *x, size_t n, P4_Uint u)
+{
+	size_t i = 0;
+#ifdef P4_CV_VECTOR
+	P4_Cvec v = { 0 };
+	v += u;
+	for ( ; i + P4_CV_LANES <= n; i += P4_CV_LANES) {
+		P4_CV_STORE(x + i, v);
+	}
+#endif
+	for ( ; i < n; i++) {
+		x[i] = u;
+	}
+}
+
+P4_CV_CLONES static P4_Uint
+p4CvCountEq(const P4_Uint *x, size_t n, P4_Uint u)
+{
+	size_t i = 0;
+	P4_Uint count = 0;
+#ifdef P4_CV_VECTOR
+	/* Lanes that compare equal are -1, so subtract to count. */
+	P4_Cvec_s acc = { 0 }, v = { 0 };
+	v += u;
+	for ( ; i + P4_CV_LANES <= n; i += P4_CV_LANES) {
+		acc -= (P4_Cvec_s) P4_CV_LOAD(x + i) == v;
+	}
+	for (size_t j = 0; j < P4_CV_LANES; j++) {
+		count += acc[j];
+	}
+#endif
+	for ( ; i < n; i++) {
+		count += x[i] == u;
+	}
+	return count;
+}
+
+/*
+ * Runs of the same value, common in real data, make each increment wait
+ * on the store of the previous one.  Alternate between two sets of
+ * counts, when they fit on the C stack, and sum them at the end.
+ */
+#ifndef P4_CV_HISTOGRAM_SPLIT
+#define P4_CV_HISTOGRAM_SPLIT	1024		/* in cells */
+#endif
+
+static void
+p4CvHistogram(const P4_Uint *x, size_t n, P4_Uint *bins, P4_Uint nbins)
+{
+	size_t i = 0;
+	if (nbins <= P4_CV_HISTOGRAM_SPLIT) {
+		P4_Uint odd[P4_CV_HISTOGRAM_SPLIT];
+		(void) memset(odd, 0, nbins * sizeof (*odd));
+		for ( ; i + 2 <= n; i += 2) {
+			if (x[i] < nbins) {
+				bins[x[i]]++;
+			}
+			if (x[i+1] < nbins) {
+				odd[x[i+1]]++;
+			}
+		}
+		for (P4_Uint j = 0; j < nbins; j++) {
+			bins[j] += odd[j];
+		}
+	}
+	for ( ; i < n; i++) {
+		if (x[i] < nbins) {
+			bins[x[i]]++;
+		}
+	}
+}
+
+typedef void (*P4_Cv_Binary)(const P4_Uint *, const P4_Uint *, P4_Uint *, size_t);
+
+/* ( aaddr1 aaddr2 aaddr3 u -- ) */
+static void
+p4CvBinary(P4_Ctx *ctx, P4_Cv_Binary fn)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Uint *c = P4_POP(ctx->ds).v;
+	P4_Uint *b = P4_POP(ctx->ds).v;
+	P4_Uint *a = P4_POP(ctx->ds).v;
+	(*fn)(a, b, c, n);
+}
+
+/*
+ * cv-add ( aaddr1 aaddr2 aaddr3 u -- )
+ */
+static void
+p4CvAddHook(P4_Ctx *ctx)
+{
+	p4CvBinary(ctx, p4CvAdd);
+}
+
+/*
+ * cv-sub ( aaddr1 aaddr2 aaddr3 u -- )
+ */
+static void
+p4CvSubHook(P4_Ctx *ctx)
+{
+	p4CvBinary(ctx, p4CvSub);
+}
+
+/*
+ * cv-mul ( aaddr1 aaddr2 aaddr3 u -- )
+ */
+static void
+p4CvMulHook(P4_Ctx *ctx)
+{
+	p4CvBinary(ctx, p4CvMul);
+}
+
+/*
+ * cv-sum ( aaddr u -- n )
+ */
+static void
+p4CvSumHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_TOP(ctx->ds).u = p4CvSum(P4_TOP(ctx->ds).v, n);
+}
+
+/* ( aaddr u -- n index ) */
+static void
+p4CvExtremeHook(P4_Ctx *ctx, P4_Int flip)
+{
+	size_t n = P4_TOP(ctx->ds).z;
+	P4_Int *x = P4_PICK(ctx->ds, 1).v;
+	P4_Int at = p4CvExtreme(x, n, flip);
+	P4_PICK(ctx->ds, 1).n = at < 0 ? P4_INT_MAX ^ flip : x[at];
+	P4_TOP(ctx->ds).n = at;
+}
+
+/*
+ * cv-min ( aaddr u -- n index )
+ */
+static void
+p4CvMinHook(P4_Ctx *ctx)
+{
+	p4CvExtremeHook(ctx, 0);
+}
+
+/*
+ * cv-max ( aaddr u -- n index )
+ */
+static void
+p4CvMaxHook(P4_Ctx *ctx)
+{
+	p4CvExtremeHook(ctx, -1);
+}
+
+/*
+ * cv-scan ( aaddr1 aaddr2 u -- )
+ */
+static void
+p4CvScanHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Uint *y = P4_POP(ctx->ds).v;
+	p4CvScan(P4_POP(ctx->ds).v, y, n);
+}
+
+/*
+ * cv-fill ( aaddr u x -- )
+ */
+static void
+p4CvFillHook(P4_Ctx *ctx)
+{
+	P4_Uint u = P4_POP(ctx->ds).u;
+	size_t n = P4_POP(ctx->ds).z;
+	p4CvFill(P4_POP(ctx->ds).v, n, u);
+}
+
+/*
+ * cv-count-eq ( aaddr u1 x -- u2 )
+ */
+static void
+p4CvCountEqHook(P4_Ctx *ctx)
+{
+	P4_Uint u = P4_POP(ctx->ds).u;
+	size_t n = P4_POP(ctx->ds).z;
+	P4_TOP(ctx->ds).u = p4CvCountEq(P4_TOP(ctx->ds).v, n, u);
+}
+
+/*
+ * cv-histogram ( aaddr1 u1 aaddr2 u2 -- )
+ */
+static void
+p4CvHistogramHook(P4_Ctx *ctx)
+{
+	P4_Uint nbins = P4_POP(ctx->ds).u;
+	P4_Uint *bins = P4_POP(ctx->ds).v;
+	size_t n = P4_POP(ctx->ds).z;
+	p4CvHistogram(P4_POP(ctx->ds).v, n, bins, nbins);
+}
+
+P4_Hook p4_cvec_hooks[] = {
+	P4_HOOK(0x40, "cv-add", p4CvAddHook),
+	P4_HOOK(0x40, "cv-sub", p4CvSubHook),
+	P4_HOOK(0x40, "cv-mul", p4CvMulHook),
+	P4_HOOK(0x21, "cv-sum", p4CvSumHook),
+	P4_HOOK(0x22, "cv-min", p4CvMinHook),
+	P4_HOOK(0x22, "cv-max", p4CvMaxHook),
+	P4_HOOK(0x30, "cv-scan", p4CvScanHook),
+	P4_HOOK(0x30, "cv-fill", p4CvFillHook),
+	P4_HOOK(0x31, "cv-count-eq", p4CvCountEqHook),
+	P4_HOOK(0x40, "cv-histogram", p4CvHistogramHook),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
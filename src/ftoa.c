@@ -0,0 +1,523 @@
+/*
+ * ftoa.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_MATH_H
+
+/*
+ * Round-trip, usually shortest, digits by Florian Loitsch's Grisu2,
+ * "Printing Floating-Point Numbers Quickly and Accurately with Integers",
+ * PLDI 2010.  Grisu2 always round-trips, but for about 0.1% of doubles
+ * gives a digit more than the shortest string.
+ *
+ * Fixed precision output is rounded from the Grisu2 digits, which is
+ * exact unless a rounding boundary could lie between them and the true
+ * value; such cases, and requests beyond double precision, defer to the
+ * C library.
+ */
+
+#define P4_DIY_SIGNIFICAND_BITS	52
+#define P4_DIY_HIDDEN		((uint64_t) 1 << P4_DIY_SIGNIFICAND_BITS)
+#define P4_DIY_EXP_BIAS		(1023 + P4_DIY_SIGNIFICAND_BITS)
+
+/* Decimal digits of a double beyond which a rounding boundary might lie
+ * between the Grisu2 digits and the true value.
+ */
+#define P4_FLOAT_SAFE_DIGITS	15
+
+typedef struct {
+	uint64_t	f;
+	int		e;
+} P4_Diy_Fp;
+
+/* Cached 10^k, k = -348 + 8 * i, normalised; built on first use. */
+#define P4_CACHED_POWERS	87
+#define P4_CACHED_POWER_MIN	(-348)
+#define P4_CACHED_POWER_STEP	8
+
+static P4_Diy_Fp p4_cached_powers[P4_CACHED_POWERS];
+
+static const uint32_t p4_pow10[] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static const double p4_pow10_neg[] = {
+	1e-0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9, 1e-10,
+	1e-11, 1e-12, 1e-13, 1e-14, 1e-15
+};
+
+/***********************************************************************
+ *** Exact powers of ten for the cache
+ ***********************************************************************/
+
+#define P4_BIG_WORDS		48		/* 1536 bits */
+
+typedef struct {
+	int		length;
+	uint32_t	word[P4_BIG_WORDS];	/* Least significant first. */
+} P4_Big;
+
+static void
+p4BigMulSmall(P4_Big *b, uint32_t m)
+{
+	uint64_t carry = 0;
+	for (int i = 0; i < b->length; i++) {
+		carry += (uint64_t) b->word[i] * m;
+		b->word[i] = (uint32_t) carry;
+		carry >>= 32;
+	}
+	if (carry != 0) {
+		b->word[b->length++] = (uint32_t) carry;
+	}
+}
+
+static void
+p4BigDivSmall(P4_Big *b, uint32_t d)
+{
+	uint64_t rem = 0;
+	for (int i = b->length; 0 < i--; ) {
+		rem = (rem << 32) | b->word[i];
+		b->word[i] = (uint32_t) (rem / d);
+		rem %= d;
+	}
+	while (0 < b->length && b->word[b->length - 1] == 0) {
+		b->length--;
+	}
+}
+
+static int
+p4BigBits(const P4_Big *b)
+{
+	int bits = (b->length - 1) * 32;
+	for (uint32_t top = b->word[b->length - 1]; top != 0; top >>= 1) {
+		bits++;
+	}
+	return bits;
+}
+
+static int
+p4BigBit(const P4_Big *b, int n)
+{
+	return n < 0 ? 0 : (b->word[n / 32] >> (n % 32)) & 1;
+}
+
+/* The 64 most significant bits of b, rounded; b * 2^-scale = f * 2^e */
+static P4_Diy_Fp
+p4BigTop(const P4_Big *b, int scale)
+{
+	P4_Diy_Fp fp;
+	int bits = p4BigBits(b);
+
+	fp.f = 0;
+	for (int n = bits - 1; bits - 64 <= n; n--) {
+		fp.f = (fp.f << 1) | p4BigBit(b, n);
+	}
+	fp.e = bits - 64 - scale;
+	if (p4BigBit(b, bits - 65) && ++fp.f == 0) {
+		fp.f = (uint64_t) 1 << 63;
+		fp.e++;
+	}
+	return fp;
+}
+
+static void
+p4CachedPowersInit(void)
+{
+	P4_Big b;
+	int i, k, n, scale;
+
+	for (i = 0; i < P4_CACHED_POWERS; i++) {
+		k = P4_CACHED_POWER_MIN + i * P4_CACHED_POWER_STEP;
+		(void) memset(&b, 0, sizeof (b));
+		if (0 <= k) {
+			/* 10^k */
+			b.length = 1;
+			b.word[0] = 1;
+			for (n = 0; n < k; n++) {
+				p4BigMulSmall(&b, 10);
+			}
+			scale = 0;
+		} else {
+			/* floor(2^scale / 10^-k) with 72 or more significant bits. */
+			scale = 72 + (int) ceil(-k * 3.321928094887362);
+			b.length = scale / 32 + 1;
+			b.word[scale / 32] = (uint32_t) 1 << (scale % 32);
+			for (n = 0; n < -k; n++) {
+				p4BigDivSmall(&b, 10);
+			}
+		}
+		p4_cached_powers[i] = p4BigTop(&b, scale);
+	}
+}
+
+/***********************************************************************
+ *** Grisu2
+ ***********************************************************************/
+
+static P4_Diy_Fp
+p4DiyFromDouble(double d)
+{
+	P4_Diy_Fp fp;
+	uint64_t bits;
+	int biased;
+
+	(void) memcpy(&bits, &d, sizeof (bits));
+	biased = (int) ((bits >> P4_DIY_SIGNIFICAND_BITS) & 0x7FF);
+	fp.f = bits & (P4_DIY_HIDDEN - 1);
+	if (biased != 0) {
+		fp.f += P4_DIY_HIDDEN;
+		fp.e = biased - P4_DIY_EXP_BIAS;
+	} else {
+		fp.e = 1 - P4_DIY_EXP_BIAS;
+	}
+	return fp;
+}
+
+static P4_Diy_Fp
+p4DiyNormalize(P4_Diy_Fp fp)
+{
+	int shift;
+#ifdef __GNUC__
+	shift = __builtin_clzll(fp.f);
+#else
+	for (shift = 0; (fp.f << shift & (uint64_t) 1 << 63) == 0; shift++)
+		;
+#endif
+	fp.f <<= shift;
+	fp.e -= shift;
+	return fp;
+}
+
+/* Product rounded to 64 bits. */
+static P4_Diy_Fp
+p4DiyMul(P4_Diy_Fp x, P4_Diy_Fp y)
+{
+	P4_Diy_Fp fp;
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 p = (unsigned __int128) x.f * y.f;
+	fp.f = (uint64_t) (p >> 64) + (((uint64_t) p >> 63) & 1);
+#else
+	const uint64_t M32 = 0xFFFFFFFF;
+	uint64_t a = x.f >> 32, b = x.f & M32, c = y.f >> 32, d = y.f & M32;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32) + ((uint64_t) 1 << 31);
+	fp.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+#endif
+	fp.e = x.e + y.e + 64;
+	return fp;
+}
+
+/* The boundaries m- and m+ halfway to the neighbouring doubles. */
+static void
+p4DiyBoundaries(P4_Diy_Fp v, P4_Diy_Fp *minus, P4_Diy_Fp *plus)
+{
+	P4_Diy_Fp pl = { (v.f << 1) + 1, v.e - 1 };
+	P4_Diy_Fp mi;
+
+	pl = p4DiyNormalize(pl);
+	if (v.f == P4_DIY_HIDDEN) {
+		/* The next double down is closer at a power of two. */
+		mi.f = (v.f << 2) - 1;
+		mi.e = v.e - 2;
+	} else {
+		mi.f = (v.f << 1) - 1;
+		mi.e = v.e - 1;
+	}
+	mi.f <<= mi.e - pl.e;
+	mi.e = pl.e;
+	*minus = mi;
+	*plus = pl;
+}
+
+/* Cached power c such that the exponent of w * c is in [-60, -32]. */
+static P4_Diy_Fp
+p4CachedPower(int e, int *K)
+{
+	double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int k = (int) dk, index;
+
+	if (p4_cached_powers[0].f == 0) {
+		p4CachedPowersInit();
+	}
+	if (dk - k > 0.0) {
+		k++;
+	}
+	index = (k >> 3) + 1;
+	*K = -(P4_CACHED_POWER_MIN + index * P4_CACHED_POWER_STEP);
+	return p4_cached_powers[index];
+}
+
+static void
+p4GrisuRound(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa
+	&& (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+static int
+p4CountDigits(uint32_t n)
+{
+	int d = 1;
+	while (d < 10 && p4_pow10[d] <= n) {
+		d++;
+	}
+	return d;
+}
+
+static int
+p4DigitGen(P4_Diy_Fp w, P4_Diy_Fp mp, uint64_t delta, char *buf, int *K)
+{
+	int len = 0, kappa;
+	uint32_t d, p1;
+	uint64_t tmp, p2;
+	const int shift = -mp.e;
+	const uint64_t one = (uint64_t) 1 << shift;
+	const uint64_t wp_w = mp.f - w.f;
+
+	p1 = (uint32_t) (mp.f >> shift);
+	p2 = mp.f & (one - 1);
+	for (kappa = p4CountDigits(p1); 0 < kappa; ) {
+		d = p1 / p4_pow10[kappa - 1];
+		p1 %= p4_pow10[kappa - 1];
+		if (d != 0 || len != 0) {
+			buf[len++] = (char) ('0' + d);
+		}
+		kappa--;
+		tmp = ((uint64_t) p1 << shift) + p2;
+		if (tmp <= delta) {
+			*K += kappa;
+			p4GrisuRound(buf, len, delta, tmp, (uint64_t) p4_pow10[kappa] << shift, wp_w);
+			return len;
+		}
+	}
+	for (;;) {
+		p2 *= 10;
+		delta *= 10;
+		d = (uint32_t) (p2 >> shift);
+		if (d != 0 || len != 0) {
+			buf[len++] = (char) ('0' + d);
+		}
+		p2 &= one - 1;
+		kappa--;
+		if (p2 < delta) {
+			*K += kappa;
+			p4GrisuRound(buf, len, delta, p2, one, -kappa < 10 ? wp_w * p4_pow10[-kappa] : 0);
+			return len;
+		}
+	}
+}
+
+int
+p4FloatShortest(double v, char digits[P4_FLOAT_DIGITS], int *exp10)
+{
+	int len, K;
+	P4_Diy_Fp w, wm, wp, c;
+
+	w = p4DiyFromDouble(v);
+	p4DiyBoundaries(w, &wm, &wp);
+	c = p4CachedPower(wp.e, &K);
+	w = p4DiyMul(p4DiyNormalize(w), c);
+	wp = p4DiyMul(wp, c);
+	wm = p4DiyMul(wm, c);
+	wm.f++;
+	wp.f--;
+	len = p4DigitGen(w, wp, wp.f - wm.f, digits, &K);
+	*exp10 = K + len - 1;
+	return len;
+}
+
+/***********************************************************************
+ *** Formatting
+ ***********************************************************************/
+
+void
+p4FloatDigits(double v, int p, char *out, int *exp10)
+{
+	int i, n, X;
+	double tail;
+	char d[P4_FLOAT_DIGITS], num[P4_FLOAT_MAXDIG + STRLEN("0.e-999") + 1];
+
+	if (v == 0) {
+		(void) memset(out, '0', p);
+		*exp10 = 0;
+		return;
+	}
+	/* Subnormals have fewer significant bits than the margin allows. */
+	if (p <= P4_FLOAT_SAFE_DIGITS && DBL_MIN <= v) {
+		n = p4FloatShortest(v, d, &X);
+		if (n <= p) {
+			(void) memcpy(out, d, n);
+			(void) memset(out + n, '0', p - n);
+			*exp10 = X;
+			return;
+		}
+		/* Discarded digits as a fraction of the last digit kept. */
+		for (tail = 0, i = n; p < i--; ) {
+			tail = (tail + (d[i] - '0')) / 10;
+		}
+		/* Grisu2 digits are within half an ulp of v; beyond that
+		 * margin from a half, v rounds the same way as the digits.
+		 */
+		if (p4_pow10_neg[P4_FLOAT_SAFE_DIGITS - p] < fabs(tail - 0.5)) {
+			(void) memcpy(out, d, p);
+			if (0.5 < tail) {
+				for (i = p; 0 < i--; ) {
+					if (out[i] < '9') {
+						out[i]++;
+						break;
+					}
+					out[i] = '0';
+				}
+				if (i < 0) {
+					out[0] = '1';
+					X++;
+				}
+			}
+			*exp10 = X;
+			return;
+		}
+	}
+	(void) snprintf(num, sizeof (num), "%.*E", p - 1, v);
+	out[0] = num[0];
+	(void) memcpy(out + 1, num + 2, p - 1);
+	*exp10 = (int) strtol(num + p + 1 + (1 < p), NULL, 10);
+}
+
+static char *
+p4FloatExp(char *s, int X, int min)
+{
+	char e[8];
+	int n = 0;
+
+	if (X < 0) {
+		*s++ = '-';
+		X = -X;
+	} else if (1 < min) {
+		*s++ = '+';
+	}
+	do {
+		e[n++] = (char) ('0' + X % 10);
+		X /= 10;
+	} while (X != 0 || n < min);
+	while (0 < n) {
+		*s++ = e[--n];
+	}
+	return s;
+}
+
+int
+p4FloatFormat(char *buf, P4_Float f, int prec, int style)
+{
+	char *s = buf, d[P4_FLOAT_MAXDIG];
+	int i, p, X, X0, ip, has;
+	double v = fabs((double) f);
+
+	if (!isfinite(f) || prec < 0 || P4_FLOAT_MAXDIG < prec + 1) {
+		goto libc;
+	}
+	if (signbit(f)) {
+		*s++ = '-';
+	}
+	switch (style) {
+	case 'F':
+		X0 = 0;
+		if (v != 0) {
+			(void) p4FloatShortest(v, d, &X0);
+		}
+		if ((p = X0 + 1 + prec) <= 0 || P4_FLOAT_MAXDIG < p) {
+			goto libc;
+		}
+		p4FloatDigits(v, p, d, &X);
+		/* A carry adds a leading digit; X0 < X gives one more zero. */
+		has = p;
+		for (i = 0; i <= X || i == 0; i++) {
+			*s++ = X < 0 ? '0' : i < has ? d[i] : '0';
+		}
+		if (0 < prec) {
+			*s++ = '.';
+			for (i = 0; i < prec; i++) {
+				int idx = X + 1 + i;
+				*s++ = idx < 0 || has <= idx ? '0' : d[idx];
+			}
+		}
+		break;
+	case 'E':
+		p4FloatDigits(v, prec + 1, d, &X);
+		*s++ = d[0];
+		if (0 < prec) {
+			*s++ = '.';
+			(void) memcpy(s, d + 1, prec);
+			s += prec;
+		}
+		*s++ = 'E';
+		s = p4FloatExp(s, X, 2);
+		break;
+	case 'e':
+		/* Engineering, prec significant digits, 1 <= significand < 1000. */
+		p = prec < 1 ? 1 : prec;
+		p4FloatDigits(v, p, d, &X);
+		X0 = v == 0 ? 0 : X - ((X % 3) + 3) % 3;
+		ip = X - X0 + 1;
+		for (i = 0; i < ip; i++) {
+			*s++ = i < p ? d[i] : '0';
+		}
+		if (ip < p) {
+			*s++ = '.';
+			(void) memcpy(s, d + ip, p - ip);
+			s += p - ip;
+		}
+		*s++ = 'E';
+		s = p4FloatExp(s, X0, 2);
+		break;
+	}
+	*s = '\0';
+	return (int) (s - buf);
+libc:
+	return snprintf(buf, P4_FLOAT_BUFFER, style == 'F' ? "%.*F" : "%.*E", prec, (double) f);
+}
+
+size_t
+p4FloatString(char *buf, P4_Float f)
+{
+	int i, n, X;
+	char *s = buf, d[P4_FLOAT_DIGITS];
+	double v = fabs((double) f);
+
+	if (isnan(f)) {
+		return (size_t) snprintf(buf, P4_FLOAT_STRING, "%sNAN", signbit(f) ? "-" : "");
+	}
+	if (signbit(f)) {
+		*s++ = '-';
+	}
+	if (isinf(f)) {
+		(void) strcpy(s, "INF");
+		return s - buf + 3;
+	}
+	if (v == 0) {
+		n = 1;
+		d[0] = '0';
+		X = 0;
+	} else {
+		n = p4FloatShortest(v, d, &X);
+	}
+	*s++ = d[0];
+	if (1 < n) {
+		*s++ = '.';
+		for (i = 1; i < n; i++) {
+			*s++ = d[i];
+		}
+	}
+	*s++ = 'E';
+	s = p4FloatExp(s, X, 1);
+	*s = '\0';
+	return s - buf;
+}
+
+#endif /* HAVE_MATH_H */
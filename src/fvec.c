@@ -0,0 +1,637 @@
+/*
+ * fvec.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#if defined(HAVE_HOOKS) && defined(HAVE_MATH_H)
+
+/*
+ * Kernels over contiguous arrays of P4_Float.  With GCC or Clang the
+ * main loops use generic vector types, which the compiler lowers to
+ * SSE2 / NEON, or to AVX2 in the clone selected at load time on x86_64
+ * with glibc.  A scalar loop handles the tail and other compilers.
+ *
+ * Sums and dot products accumulate by lane, so the order of additions,
+ * and hence the rounding, differs from a simple loop.
+ */
+#ifdef __GNUC__
+# define P4_FV_VECTOR
+# define P4_FV_BYTES		32
+typedef P4_Float P4_Fvec __attribute__((vector_size(P4_FV_BYTES)));
+/* P4_Int matches the width of P4_Float. */
+typedef P4_Int P4_Fmask __attribute__((vector_size(P4_FV_BYTES)));
+# define P4_FV_LANES		(P4_FV_BYTES / sizeof (P4_Float))
+#endif
+
+#if defined(P4_FV_VECTOR) && defined(__x86_64__) && defined(__GLIBC__) && defined(__has_attribute)
+# if __has_attribute(target_clones)
+#  define P4_FV_CLONES		__attribute__((target_clones("avx2", "default")))
+# endif
+#endif
+#ifndef P4_FV_CLONES
+# define P4_FV_CLONES
+#endif
+
+/* Kernels shared by several words are inlined into each caller, so
+ * that they are compiled for the caller's instruction set.
+ */
+#ifdef __GNUC__
+# define P4_FV_INLINE		static inline __attribute__((always_inline))
+#else
+# define P4_FV_INLINE		static inline
+#endif
+
+#ifdef P4_FV_VECTOR
+/* Unaligned access; vectors are never passed by value, since that
+ * depends on the instruction set of the caller.
+ */
+typedef P4_Float P4_Fvec_u __attribute__((vector_size(P4_FV_BYTES), aligned(sizeof (P4_Float)), may_alias));
+
+# define P4_FV_LOAD(p)		(*(const P4_Fvec_u *) (p))
+# define P4_FV_STORE(p, v)	(*(P4_Fvec_u *) (p) = (v))
+
+/* Select lanes of a where mask is set, else b. */
+# define P4_FV_SELECT(m, a, b)	((P4_Fvec) (((m) & (P4_Fmask) (a)) | (~(m) & (P4_Fmask) (b))))
+
+P4_FV_INLINE P4_Float
+p4FvHsum(const P4_Fvec *v)
+{
+	P4_Float sum = 0;
+	for (size_t j = 0; j < P4_FV_LANES; j++) {
+		sum += (*v)[j];
+	}
+	return sum;
+}
+#endif
+
+#ifdef P4_FV_VECTOR
+# define P4_FV_BINARY_LOOP(OP) \
+	for ( ; i + P4_FV_LANES <= n; i += P4_FV_LANES) \
+		P4_FV_STORE(c + i, P4_FV_LOAD(a + i) OP P4_FV_LOAD(b + i))
+#else
+# define P4_FV_BINARY_LOOP(OP)
+#endif
+
+#define P4_FV_BINARY(fn, OP) \
+P4_FV_CLONES static void \
+fn(const P4_Float *a, const P4_Float *b, P4_Float *c, size_t n) \
+{ \
+	size_t i = 0; \
+	P4_FV_BINARY_LOOP(OP); \
+	for ( ; i < n; i++) { \
+		c[i] = a[i] OP b[i]; \
+	} \
+}
+
+P4_FV_BINARY(p4FvAdd, +)
+P4_FV_BINARY(p4FvSub, -)
+P4_FV_BINARY(p4FvMul, *)
+P4_FV_BINARY(p4FvDiv, /)
+
+P4_FV_CLONES static void
+p4FvScale(const P4_Float *x, P4_Float *y, size_t n, P4_Float r)
+{
+	size_t i = 0;
+#ifdef P4_FV_VECTOR
+	for ( ; i + P4_FV_LANES <= n; i += P4_FV_LANES) {
+		P4_FV_STORE(y + i, P4_FV_LOAD(x + i) * r);
+	}
+#endif
+	for ( ; i < n; i++) {
+		y[i] = x[i] * r;
+	}
+}
+
+P4_FV_INLINE void
+p4FvAxpyKernel(const P4_Float *x, P4_Float *y, size_t n, P4_Float r)
+{
+	size_t i = 0;
+#ifdef P4_FV_VECTOR
+	for ( ; i + P4_FV_LANES <= n; i += P4_FV_LANES) {
+		P4_FV_STORE(y + i, P4_FV_LOAD(y + i) + P4_FV_LOAD(x + i) * r);
+	}
+#endif
+	for ( ; i < n; i++) {
+		y[i] += x[i] * r;
+	}
+}
+
+P4_FV_CLONES static void
+p4FvAxpy(const P4_Float *x, P4_Float *y, size_t n, P4_Float r)
+{
+	p4FvAxpyKernel(x, y, n, r);
+}
+
+P4_FV_INLINE P4_Float
+p4FvDotKernel(const P4_Float *x, const P4_Float *y, size_t n)
+{
+	size_t i = 0;
+	P4_Float sum = 0;
+#ifdef P4_FV_VECTOR
+	P4_Fvec acc = { 0 };
+	for ( ; i + P4_FV_LANES <= n; i += P4_FV_LANES) {
+		acc += P4_FV_LOAD(x + i) * P4_FV_LOAD(y + i);
+	}
+	sum = p4FvHsum(&acc);
+#endif
+	for ( ; i < n; i++) {
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+P4_FV_CLONES static P4_Float
+p4FvDot(const P4_Float *x, const P4_Float *y, size_t n)
+{
+	return p4FvDotKernel(x, y, n);
+}
+
+P4_FV_CLONES static P4_Float
+p4FvSum(const P4_Float *x, size_t n)
+{
+	size_t i = 0;
+	P4_Float sum = 0;
+#ifdef P4_FV_VECTOR
+	P4_Fvec acc = { 0 };
+	for ( ; i + P4_FV_LANES <= n; i += P4_FV_LANES) {
+		acc += P4_FV_LOAD(x + i);
+	}
+	sum = p4FvHsum(&acc);
+#endif
+	for ( ; i < n; i++) {
+		sum += x[i];
+	}
+	return sum;
+}
+
+/* Minimum when sign is 1, maximum when -1; infinity when empty. */
+P4_FV_CLONES static P4_Float
+p4FvExtreme(const P4_Float *x, size_t n, P4_Float sign)
+{
+	size_t i = 0;
+	P4_Float m = sign * HUGE_VAL;
+#ifdef P4_FV_VECTOR
+	if (P4_FV_LANES <= n) {
+		P4_Fvec v, best = P4_FV_LOAD(x) * sign;
+		for (i = P4_FV_LANES; i + P4_FV_LANES <= n; i += P4_FV_LANES) {
+			v = P4_FV_LOAD(x + i) * sign;
+			best = P4_FV_SELECT(v < best, v, best);
+		}
+		for (size_t j = 0; j < P4_FV_LANES; j++) {
+			if (best[j] < m * sign) {
+				m = best[j] * sign;
+			}
+		}
+	}
+#endif
+	for ( ; i < n; i++) {
+		if (x[i] * sign < m * sign) {
+			m = x[i];
+		}
+	}
+	return m;
+}
+
+static void
+p4FvSqrt(const P4_Float *x, P4_Float *y, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		y[i] = sqrt(x[i]);
+	}
+}
+
+P4_FV_CLONES static void
+p4FvFill(P4_Float *x, size_t n, P4_Float r)
+{
+	size_t i = 0;
+#ifdef P4_FV_VECTOR
+	P4_Fvec v = { 0 };
+	v += r;
+	for ( ; i + P4_FV_LANES <= n; i += P4_FV_LANES) {
+		P4_FV_STORE(x + i, v);
+	}
+#endif
+	for ( ; i < n; i++) {
+		x[i] = r;
+	}
+}
+
+/*
+ * Row-major matrices.  A panel of P4_MAT_BLOCK rows of B stays in cache
+ * while the rows of A sweep over it.  The micro-kernel keeps a tile of
+ * four rows by two vectors of C in registers across the panel; edges
+ * fall back to a vector AXPY across a row segment of C.
+ */
+#ifndef P4_MAT_BLOCK
+#define P4_MAT_BLOCK		64		/* in floats */
+#endif
+
+/* Define as the number of threads for large products; needs -pthread. */
+#ifdef P4_MAT_THREADS
+# include <pthread.h>
+# ifndef P4_MAT_PARALLEL
+#  define P4_MAT_PARALLEL	(128 * 128 * 128)	/* multiply-adds */
+# endif
+#endif
+
+#define P4_MAT_MIN(a, b)	((a) < (b) ? (a) : (b))
+
+typedef struct {
+	const P4_Float *a;
+	const P4_Float *b;
+	P4_Float *c;
+	size_t i0, i1, n, k;
+} P4_Mat_Mul;
+
+#ifdef P4_FV_VECTOR
+# define P4_MAT_MR		4
+# define P4_MAT_NR		(2 * P4_FV_LANES)
+
+/* C[i..i+4, j..j+NR] += A[i..i+4, p0..p1] B[p0..p1, j..j+NR] */
+P4_FV_INLINE void
+p4MatTile(const P4_Mat_Mul *job, size_t i, size_t j, size_t p0, size_t p1)
+{
+	size_t p, n = job->n, k = job->k;
+	const P4_Float *a = job->a + i * n, *b = job->b + j;
+	P4_Float *c = job->c + i * k + j;
+	P4_Fvec b0, b1;
+	P4_Fvec c00 = P4_FV_LOAD(c), c01 = P4_FV_LOAD(c + P4_FV_LANES);
+	P4_Fvec c10 = P4_FV_LOAD(c + k), c11 = P4_FV_LOAD(c + k + P4_FV_LANES);
+	P4_Fvec c20 = P4_FV_LOAD(c + 2*k), c21 = P4_FV_LOAD(c + 2*k + P4_FV_LANES);
+	P4_Fvec c30 = P4_FV_LOAD(c + 3*k), c31 = P4_FV_LOAD(c + 3*k + P4_FV_LANES);
+
+	for (p = p0; p < p1; p++) {
+		b0 = P4_FV_LOAD(b + p * k);
+		b1 = P4_FV_LOAD(b + p * k + P4_FV_LANES);
+		c00 += b0 * a[p];	c01 += b1 * a[p];
+		c10 += b0 * a[n+p];	c11 += b1 * a[n+p];
+		c20 += b0 * a[2*n+p];	c21 += b1 * a[2*n+p];
+		c30 += b0 * a[3*n+p];	c31 += b1 * a[3*n+p];
+	}
+	P4_FV_STORE(c, c00);		P4_FV_STORE(c + P4_FV_LANES, c01);
+	P4_FV_STORE(c + k, c10);	P4_FV_STORE(c + k + P4_FV_LANES, c11);
+	P4_FV_STORE(c + 2*k, c20);	P4_FV_STORE(c + 2*k + P4_FV_LANES, c21);
+	P4_FV_STORE(c + 3*k, c30);	P4_FV_STORE(c + 3*k + P4_FV_LANES, c31);
+}
+#else
+# define P4_MAT_MR		1
+# define P4_MAT_NR		1
+#endif
+
+/* C[i0..i1, k] = A[i0..i1, n] B[n, k] */
+P4_FV_CLONES static void
+p4MatMulRows(P4_Mat_Mul *job)
+{
+	size_t i, j, p, pp, pe, je, n = job->n, k = job->k;
+
+	(void) memset(job->c + job->i0 * k, 0, (job->i1 - job->i0) * k * sizeof (*job->c));
+	for (pp = 0; pp < n; pp = pe) {
+		pe = P4_MAT_MIN(pp + P4_MAT_BLOCK, n);
+		i = job->i0;
+#ifdef P4_FV_VECTOR
+		je = k - k % P4_MAT_NR;
+		for ( ; i + P4_MAT_MR <= job->i1; i += P4_MAT_MR) {
+			for (j = 0; j < je; j += P4_MAT_NR) {
+				p4MatTile(job, i, j, pp, pe);
+			}
+			for (p = pp; je < k && p < pe; p++) {
+				for (size_t r = 0; r < P4_MAT_MR; r++) {
+					p4FvAxpyKernel(job->b + p * k + je, job->c + (i + r) * k + je, k - je, job->a[(i + r) * n + p]);
+				}
+			}
+		}
+#endif
+		for ( ; i < job->i1; i++) {
+			for (p = pp; p < pe; p++) {
+				p4FvAxpyKernel(job->b + p * k, job->c + i * k, k, job->a[i * n + p]);
+			}
+		}
+	}
+}
+
+#ifdef P4_MAT_THREADS
+static void *
+p4MatMulThread(void *data)
+{
+	p4MatMulRows(data);
+	return NULL;
+}
+#endif
+
+static void
+p4MatMul(const P4_Float *a, const P4_Float *b, P4_Float *c, size_t m, size_t n, size_t k)
+{
+	P4_Mat_Mul job = { a, b, c, 0, m, n, k };
+#ifdef P4_MAT_THREADS
+	if (1 < m && P4_MAT_PARALLEL <= m * n * k) {
+		int t, started;
+		pthread_t tid[P4_MAT_THREADS];
+		P4_Mat_Mul jobs[P4_MAT_THREADS];
+		size_t rows = (m + P4_MAT_THREADS - 1) / P4_MAT_THREADS;
+
+		/* Split the rows of C; any slice without a thread runs here. */
+		for (started = t = 0; t < P4_MAT_THREADS && t * rows < m; t++) {
+			jobs[t] = job;
+			jobs[t].i0 = t * rows;
+			jobs[t].i1 = P4_MAT_MIN(m, jobs[t].i0 + rows);
+			if (started == t && pthread_create(&tid[t], NULL, p4MatMulThread, &jobs[t]) == 0) {
+				started++;
+			} else {
+				p4MatMulRows(&jobs[t]);
+			}
+		}
+		while (0 < started) {
+			(void) pthread_join(tid[--started], NULL);
+		}
+		return;
+	}
+#endif
+	p4MatMulRows(&job);
+}
+
+static void
+p4MatTranspose(const P4_Float *a, P4_Float *t, size_t m, size_t n)
+{
+	size_t i, j, ii, jj, ie, je;
+	for (ii = 0; ii < m; ii = ie) {
+		ie = P4_MAT_MIN(ii + P4_MAT_BLOCK, m);
+		for (jj = 0; jj < n; jj = je) {
+			je = P4_MAT_MIN(jj + P4_MAT_BLOCK, n);
+			for (i = ii; i < ie; i++) {
+				for (j = jj; j < je; j++) {
+					t[j * m + i] = a[i * n + j];
+				}
+			}
+		}
+	}
+}
+
+P4_FV_CLONES static void
+p4MatVec(const P4_Float *a, const P4_Float *x, P4_Float *y, size_t m, size_t n)
+{
+	for (size_t i = 0; i < m; i++) {
+		y[i] = p4FvDotKernel(a + i * n, x, n);
+	}
+}
+
+/*
+ * Solve A x = b by LU decomposition with partial pivoting; A is replaced
+ * by its factors and b by x.  Return false if A is singular.
+ */
+P4_FV_CLONES static int
+p4MatSolve(P4_Float *a, P4_Float *b, size_t n)
+{
+	P4_Float f, t;
+	size_t i, j, p, row;
+
+	for (p = 0; p < n; p++) {
+		for (row = p, i = p + 1; i < n; i++) {
+			if (fabs(a[row * n + p]) < fabs(a[i * n + p])) {
+				row = i;
+			}
+		}
+		if (a[row * n + p] == 0) {
+			return 0;
+		}
+		if (row != p) {
+			for (j = 0; j < n; j++) {
+				t = a[p * n + j];
+				a[p * n + j] = a[row * n + j];
+				a[row * n + j] = t;
+			}
+			t = b[p];
+			b[p] = b[row];
+			b[row] = t;
+		}
+		for (i = p + 1; i < n; i++) {
+			f = a[i * n + p] / a[p * n + p];
+			a[i * n + p] = f;
+			p4FvAxpyKernel(a + p * n + p + 1, a + i * n + p + 1, n - p - 1, -f);
+			b[i] -= f * b[p];
+		}
+	}
+	for (i = n; 0 < i--; ) {
+		b[i] = (b[i] - p4FvDotKernel(a + i * n + i + 1, b + i + 1, n - i - 1)) / a[i * n + i];
+	}
+	return 1;
+}
+
+typedef void (*P4_Fv_Binary)(const P4_Float *, const P4_Float *, P4_Float *, size_t);
+
+/* ( faddr1 faddr2 faddr3 u -- ) */
+static void
+p4FvBinary(P4_Ctx *ctx, P4_Fv_Binary fn)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *c = P4_POP(ctx->ds).v;
+	P4_Float *b = P4_POP(ctx->ds).v;
+	P4_Float *a = P4_POP(ctx->ds).v;
+	(*fn)(a, b, c, n);
+}
+
+/*
+ * fv+ ( faddr1 faddr2 faddr3 u -- )
+ */
+static void
+p4FvAddHook(P4_Ctx *ctx)
+{
+	p4FvBinary(ctx, p4FvAdd);
+}
+
+/*
+ * fv- ( faddr1 faddr2 faddr3 u -- )
+ */
+static void
+p4FvSubHook(P4_Ctx *ctx)
+{
+	p4FvBinary(ctx, p4FvSub);
+}
+
+/*
+ * fv* ( faddr1 faddr2 faddr3 u -- )
+ */
+static void
+p4FvMulHook(P4_Ctx *ctx)
+{
+	p4FvBinary(ctx, p4FvMul);
+}
+
+/*
+ * fv/ ( faddr1 faddr2 faddr3 u -- )
+ */
+static void
+p4FvDivHook(P4_Ctx *ctx)
+{
+	p4FvBinary(ctx, p4FvDiv);
+}
+
+/*
+ * fv-scale ( faddr1 faddr2 u -- ) (F: r -- )
+ */
+static void
+p4FvScaleHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *y = P4_POP(ctx->ds).v;
+	P4_Float *x = P4_POP(ctx->ds).v;
+	p4FvScale(x, y, n, P4_POP(ctx->P4_FLOAT_STACK).f);
+}
+
+/*
+ * fv-axpy ( faddr1 faddr2 u -- ) (F: r -- )
+ */
+static void
+p4FvAxpyHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *y = P4_POP(ctx->ds).v;
+	P4_Float *x = P4_POP(ctx->ds).v;
+	p4FvAxpy(x, y, n, P4_POP(ctx->P4_FLOAT_STACK).f);
+}
+
+static void
+p4FvPushFloat(P4_Ctx *ctx, P4_Float r)
+{
+	P4_Cell c;
+	c.f = r;
+	p4AllocStack(ctx, &ctx->P4_FLOAT_STACK, 1);
+	P4_PUSH(ctx->P4_FLOAT_STACK, c);
+}
+
+/*
+ * fv-dot ( faddr1 faddr2 u -- ) (F: -- r )
+ */
+static void
+p4FvDotHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *y = P4_POP(ctx->ds).v;
+	P4_Float *x = P4_POP(ctx->ds).v;
+	p4FvPushFloat(ctx, p4FvDot(x, y, n));
+}
+
+/*
+ * fv-sum ( faddr u -- ) (F: -- r )
+ */
+static void
+p4FvSumHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	p4FvPushFloat(ctx, p4FvSum(P4_POP(ctx->ds).v, n));
+}
+
+/*
+ * fv-min ( faddr u -- ) (F: -- r )
+ */
+static void
+p4FvMinHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	p4FvPushFloat(ctx, p4FvExtreme(P4_POP(ctx->ds).v, n, 1));
+}
+
+/*
+ * fv-max ( faddr u -- ) (F: -- r )
+ */
+static void
+p4FvMaxHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	p4FvPushFloat(ctx, p4FvExtreme(P4_POP(ctx->ds).v, n, -1));
+}
+
+/*
+ * fv-sqrt ( faddr1 faddr2 u -- )
+ */
+static void
+p4FvSqrtHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *y = P4_POP(ctx->ds).v;
+	p4FvSqrt(P4_POP(ctx->ds).v, y, n);
+}
+
+/*
+ * fv-fill ( faddr u -- ) (F: r -- )
+ */
+static void
+p4FvFillHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	p4FvFill(P4_POP(ctx->ds).v, n, P4_POP(ctx->P4_FLOAT_STACK).f);
+}
+
+/*
+ * mat* ( faddr1 faddr2 faddr3 u1 u2 u3 -- )
+ */
+static void
+p4MatMulHook(P4_Ctx *ctx)
+{
+	size_t k = P4_POP(ctx->ds).z;
+	size_t n = P4_POP(ctx->ds).z;
+	size_t m = P4_POP(ctx->ds).z;
+	P4_Float *c = P4_POP(ctx->ds).v;
+	P4_Float *b = P4_POP(ctx->ds).v;
+	p4MatMul(P4_POP(ctx->ds).v, b, c, m, n, k);
+}
+
+/*
+ * mat*v ( faddr1 faddr2 faddr3 u1 u2 -- )
+ */
+static void
+p4MatMulVec(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	size_t m = P4_POP(ctx->ds).z;
+	P4_Float *y = P4_POP(ctx->ds).v;
+	P4_Float *x = P4_POP(ctx->ds).v;
+	p4MatVec(P4_POP(ctx->ds).v, x, y, m, n);
+}
+
+/*
+ * mat-transpose ( faddr1 faddr2 u1 u2 -- )
+ */
+static void
+p4MatTransposeHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	size_t m = P4_POP(ctx->ds).z;
+	P4_Float *t = P4_POP(ctx->ds).v;
+	p4MatTranspose(P4_POP(ctx->ds).v, t, m, n);
+}
+
+/*
+ * mat-solve ( faddr1 faddr2 u -- flag )
+ */
+static void
+p4MatSolveHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *b = P4_POP(ctx->ds).v;
+	P4_TOP(ctx->ds).n = -p4MatSolve(P4_TOP(ctx->ds).v, b, n);
+}
+
+P4_Hook p4_fvec_hooks[] = {
+	P4_HOOK(0x40, "fv+", p4FvAddHook),
+	P4_HOOK(0x40, "fv-", p4FvSubHook),
+	P4_HOOK(0x40, "fv*", p4FvMulHook),
+	P4_HOOK(0x40, "fv/", p4FvDivHook),
+	P4_HOOK(0x100030, "fv-scale", p4FvScaleHook),
+	P4_HOOK(0x100030, "fv-axpy", p4FvAxpyHook),
+	P4_HOOK(0x010030, "fv-dot", p4FvDotHook),
+	P4_HOOK(0x010020, "fv-sum", p4FvSumHook),
+	P4_HOOK(0x010020, "fv-min", p4FvMinHook),
+	P4_HOOK(0x010020, "fv-max", p4FvMaxHook),
+	P4_HOOK(0x30, "fv-sqrt", p4FvSqrtHook),
+	P4_HOOK(0x100020, "fv-fill", p4FvFillHook),
+	P4_HOOK(0x60, "mat*", p4MatMulHook),
+	P4_HOOK(0x50, "mat*v", p4MatMulVec),
+	P4_HOOK(0x40, "mat-transpose", p4MatTransposeHook),
+	P4_HOOK(0x31, "mat-solve", p4MatSolveHook),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS && HAVE_MATH_H */
@@ -0,0 +1,692 @@
+/*
+ * heap.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+/*
+ * Dynamic memory for ALLOCATE, RESIZE, and FREE.
+ *
+ * Small requests are carved from slab pages, one size class per page,
+ * with freed blocks kept on a per-page free list.  A slab page is found
+ * from a block address by a binary search of the sorted page addresses.
+ * Larger requests go to malloc and are recorded in a hash table keyed by
+ * address, so their size is known when freed.
+ *
+ * Memory from C library functions, like strdup or getcwd, is passed to
+ * FREE in places, so a pointer that is neither in a slab nor the table
+ * is simply given to free or realloc.
+ *
+ * When profiling, small blocks are also recorded in the table along with
+ * the allocation site, being the IP of the word calling ALLOCATE or
+ * RESIZE followed by the return addresses on top of the return stack.
+ *
+ * The slabs and table are shared by all contexts, so are guarded by a
+ * spin lock for contexts running in separate threads, eg. from JNI.
+ * The allocation site is per thread.  Without C11 atomics (or thread
+ * local storage) the heap is for a single thread only.
+ */
+
+#define P4_SLAB_PAGE		(64 * 1024)	/* in bytes, power of 2 */
+#define P4_SLAB_ALIGN		16		/* in bytes, power of 2 */
+
+static const unsigned short p4_slab_sizes[] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256, 320, 384, 448, 512,
+};
+
+#if 512 < P4_SLAB_MAX
+# error "P4_SLAB_MAX is larger than the largest size class."
+#endif
+
+typedef struct p4_slab P4_Slab;
+
+struct p4_slab {
+	P4_Slab *	prev;		/* pages of a class with free blocks */
+	P4_Slab *	next;
+	void *		free;		/* list of freed blocks */
+	P4_Char *	bump;		/* never used blocks start here */
+	P4_Char *	end;
+	unsigned	klass;
+	unsigned	live;
+};
+
+#define P4_SLAB_FIRST		P4_ALIGN_SIZE(sizeof (P4_Slab), P4_SLAB_ALIGN)
+
+#ifndef P4_HEAP_FRAMES
+#define P4_HEAP_FRAMES		4		/* allocation site depth */
+#endif
+
+typedef struct {
+	void *		mem;
+	size_t		size;
+	const void *	site[P4_HEAP_FRAMES];
+} P4_Heap_Entry;
+
+#ifndef __STDC_NO_ATOMICS__
+# include <stdatomic.h>
+static atomic_flag p4_heap_lock = ATOMIC_FLAG_INIT;
+# define P4_HEAP_LOCK()		while (atomic_flag_test_and_set_explicit(&p4_heap_lock, memory_order_acquire)) ;
+# define P4_HEAP_UNLOCK()	atomic_flag_clear_explicit(&p4_heap_lock, memory_order_release)
+#else
+# define P4_HEAP_LOCK()
+# define P4_HEAP_UNLOCK()
+#endif
+
+#ifndef __STDC_NO_THREADS__
+# define P4_THREAD_LOCAL	_Thread_local
+#else
+# define P4_THREAD_LOCAL
+#endif
+
+static P4_Heap_Stats p4_heap_stats;
+
+static P4_Slab *p4_slab_partial[P4_SLAB_CLASSES];
+static P4_Slab **p4_slab_pages;
+static size_t p4_slab_npages;
+static size_t p4_slab_maxpages;
+
+static P4_Heap_Entry *p4_heap_table;
+static size_t p4_heap_tsize;		/* power of 2 */
+static size_t p4_heap_tcount;
+
+static unsigned p4_heap_frames;		/* 0 when not profiling */
+static int p4_heap_profiled;		/* small blocks may be in the table */
+static P4_THREAD_LOCAL const void *p4_heap_site[P4_HEAP_FRAMES];
+
+/***********************************************************************
+ *** Statistics
+ ***********************************************************************/
+
+const P4_Heap_Stats *
+p4HeapStats(void)
+{
+	return &p4_heap_stats;
+}
+
+static void
+p4HeapCountAlloc(size_t size)
+{
+	p4_heap_stats.live_bytes += size;
+	p4_heap_stats.live_blocks++;
+	if (p4_heap_stats.peak_bytes < p4_heap_stats.live_bytes) {
+		p4_heap_stats.peak_bytes = p4_heap_stats.live_bytes;
+	}
+}
+
+static void
+p4HeapCountFree(size_t size)
+{
+	p4_heap_stats.live_bytes -= size;
+	p4_heap_stats.live_blocks--;
+}
+
+/***********************************************************************
+ *** Large blocks by address.
+ ***********************************************************************/
+
+static size_t
+p4HeapHash(void *mem)
+{
+	P4_Uint h = (P4_Uint) mem >> 4;
+	h *= (P4_Uint) 0x9E3779B97F4A7C15ULL;
+	return (size_t) (h ^ (h >> (P4_UINT_BITS / 2))) & (p4_heap_tsize - 1);
+}
+
+static P4_Heap_Entry *
+p4HeapFind(void *mem)
+{
+	if (p4_heap_tcount == 0) {
+		return NULL;
+	}
+	for (size_t i = p4HeapHash(mem); p4_heap_table[i].mem != NULL; i = (i + 1) & (p4_heap_tsize - 1)) {
+		if (p4_heap_table[i].mem == mem) {
+			return &p4_heap_table[i];
+		}
+	}
+	return NULL;
+}
+
+static P4_Heap_Entry *
+p4HeapInsert(void *mem, size_t size)
+{
+	size_t i;
+	for (i = p4HeapHash(mem); p4_heap_table[i].mem != NULL; i = (i + 1) & (p4_heap_tsize - 1)) {
+		;
+	}
+	p4_heap_table[i].mem = mem;
+	p4_heap_table[i].size = size;
+	p4_heap_tcount++;
+	return &p4_heap_table[i];
+}
+
+/* Record the pending allocation site, if any, against a new block. */
+static void
+p4HeapInsertSite(void *mem, size_t size)
+{
+	P4_Heap_Entry *entry = p4HeapInsert(mem, size);
+	(void) memcpy(entry->site, p4_heap_site, sizeof (p4_heap_site));
+	(void) memset(p4_heap_site, 0, sizeof (p4_heap_site));
+}
+
+/* Linear probing deletion, shifting later entries of the cluster back. */
+static void
+p4HeapRemove(P4_Heap_Entry *entry)
+{
+	size_t mask = p4_heap_tsize - 1;
+	size_t hole = entry - p4_heap_table;
+	for (size_t i = (hole + 1) & mask; p4_heap_table[i].mem != NULL; i = (i + 1) & mask) {
+		size_t home = p4HeapHash(p4_heap_table[i].mem);
+		/* Can entry i move back to the hole without passing its home? */
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			p4_heap_table[hole] = p4_heap_table[i];
+			hole = i;
+		}
+	}
+	p4_heap_table[hole].mem = NULL;
+	p4_heap_tcount--;
+}
+
+/* Make room for one more entry, keeping the table at most half full. */
+static int
+p4HeapReserve(void)
+{
+	P4_Heap_Entry *old = p4_heap_table;
+	size_t size = p4_heap_tsize;
+
+	if (p4_heap_tcount + 1 <= p4_heap_tsize / 2) {
+		return 0;
+	}
+	size_t tsize = p4_heap_tsize == 0 ? 64 : p4_heap_tsize * 2;
+	if ((p4_heap_table = calloc(tsize, sizeof (*p4_heap_table))) == NULL) {
+		p4_heap_table = old;
+		return -1;
+	}
+	p4_heap_tsize = tsize;
+	p4_heap_tcount = 0;
+	for (size_t i = 0; i < size; i++) {
+		if (old[i].mem != NULL) {
+			*p4HeapInsert(old[i].mem, old[i].size) = old[i];
+		}
+	}
+	free(old);
+	return 0;
+}
+
+/***********************************************************************
+ *** Slabs
+ ***********************************************************************/
+
+static unsigned
+p4SlabClass(size_t size)
+{
+	if (size <= 128) {
+		return size == 0 ? 0 : (unsigned) (size - 1) / 16;
+	}
+	if (size <= 256) {
+		return 8 + (unsigned) (size - 129) / 32;
+	}
+	return 12 + (unsigned) (size - 257) / 64;
+}
+
+static P4_Slab *
+p4SlabFind(void *mem)
+{
+	P4_Slab *page = (P4_Slab *) ((P4_Uint) mem & -(P4_Uint) P4_SLAB_PAGE);
+	size_t lo = 0, hi = p4_slab_npages;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (p4_slab_pages[mid] == page) {
+			return page;
+		}
+		if (p4_slab_pages[mid] < page) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return NULL;
+}
+
+static void
+p4SlabLink(P4_Slab *slab)
+{
+	P4_Slab **head = &p4_slab_partial[slab->klass];
+	slab->prev = NULL;
+	slab->next = *head;
+	if (*head != NULL) {
+		(*head)->prev = slab;
+	}
+	*head = slab;
+}
+
+static void
+p4SlabUnlink(P4_Slab *slab)
+{
+	if (slab->prev == NULL) {
+		p4_slab_partial[slab->klass] = slab->next;
+	} else {
+		slab->prev->next = slab->next;
+	}
+	if (slab->next != NULL) {
+		slab->next->prev = slab->prev;
+	}
+}
+
+static P4_Slab *
+p4SlabNew(unsigned klass)
+{
+	P4_Slab *slab;
+	size_t i;
+
+	if (p4_slab_maxpages <= p4_slab_npages) {
+		size_t max = p4_slab_maxpages == 0 ? 16 : p4_slab_maxpages * 2;
+		P4_Slab **pages = realloc(p4_slab_pages, max * sizeof (*pages));
+		if (pages == NULL) {
+			return NULL;
+		}
+		p4_slab_pages = pages;
+		p4_slab_maxpages = max;
+	}
+	if (posix_memalign((void **) &slab, P4_SLAB_PAGE, P4_SLAB_PAGE) != 0) {
+		return NULL;
+	}
+	slab->free = NULL;
+	slab->bump = (P4_Char *) slab + P4_SLAB_FIRST;
+	slab->end = (P4_Char *) slab + P4_SLAB_PAGE;
+	slab->klass = klass;
+	slab->live = 0;
+
+	for (i = p4_slab_npages; 0 < i && slab < p4_slab_pages[i-1]; i--) {
+		p4_slab_pages[i] = p4_slab_pages[i-1];
+	}
+	p4_slab_pages[i] = slab;
+	p4_slab_npages++;
+	p4_heap_stats.slab_pages++;
+	p4SlabLink(slab);
+
+	return slab;
+}
+
+static void
+p4SlabDelete(P4_Slab *slab)
+{
+	size_t i;
+	for (i = 0; p4_slab_pages[i] != slab; i++) {
+		;
+	}
+	(void) memmove(p4_slab_pages + i, p4_slab_pages + i + 1, (p4_slab_npages - i - 1) * sizeof (*p4_slab_pages));
+	p4_slab_npages--;
+	p4_heap_stats.slab_pages--;
+	p4SlabUnlink(slab);
+	free(slab);
+}
+
+static int
+p4SlabFull(P4_Slab *slab)
+{
+	return slab->free == NULL && slab->end - slab->bump < p4_slab_sizes[slab->klass];
+}
+
+static void *
+p4SlabAlloc(unsigned klass)
+{
+	void *mem;
+	P4_Slab *slab;
+	size_t size = p4_slab_sizes[klass];
+
+	if ((slab = p4_slab_partial[klass]) == NULL && (slab = p4SlabNew(klass)) == NULL) {
+		return NULL;
+	}
+	if ((mem = slab->free) != NULL) {
+		slab->free = *(void **) mem;
+	} else {
+		mem = slab->bump;
+		slab->bump += size;
+	}
+	slab->live++;
+	if (p4SlabFull(slab)) {
+		p4SlabUnlink(slab);
+	}
+	p4_heap_stats.class_live[klass]++;
+	p4HeapCountAlloc(size);
+	return mem;
+}
+
+static void
+p4SlabFree(P4_Slab *slab, void *mem)
+{
+	if (p4SlabFull(slab)) {
+		p4SlabLink(slab);
+	}
+	*(void **) mem = slab->free;
+	slab->free = mem;
+	slab->live--;
+	p4_heap_stats.class_live[slab->klass]--;
+	p4HeapCountFree(p4_slab_sizes[slab->klass]);
+
+	/* Keep one page per class to avoid thrashing on alloc/free pairs. */
+	if (slab->live == 0 && (slab->prev != NULL || slab->next != NULL)) {
+		p4SlabDelete(slab);
+	}
+}
+
+/***********************************************************************
+ *** API
+ ***********************************************************************/
+
+static void
+p4SlabUnprofile(void *mem)
+{
+	P4_Heap_Entry *entry;
+	if (p4_heap_profiled && (entry = p4HeapFind(mem)) != NULL) {
+		p4HeapRemove(entry);
+	}
+}
+
+static void *
+p4HeapAlloc(size_t size)
+{
+	void *mem;
+
+	if (0 < P4_SLAB_MAX && size <= P4_SLAB_MAX) {
+		if (0 < p4_heap_frames && p4HeapReserve() != 0) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		if ((mem = p4SlabAlloc(p4SlabClass(size))) == NULL) {
+			errno = ENOMEM;
+		} else if (0 < p4_heap_frames) {
+			p4HeapInsertSite(mem, p4_slab_sizes[p4SlabClass(size)]);
+		}
+		return mem;
+	}
+	if (p4HeapReserve() != 0 || (mem = malloc(size == 0 ? 1 : size)) == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	p4HeapInsertSite(mem, size);
+	p4HeapCountAlloc(size);
+	return mem;
+}
+
+static void *
+p4HeapReallocLocked(void *mem, size_t size)
+{
+	void *copy;
+	P4_Slab *slab;
+	P4_Heap_Entry *entry;
+
+	if (mem == NULL) {
+		return p4HeapAlloc(size);
+	}
+	if ((slab = p4SlabFind(mem)) != NULL) {
+		size_t old = p4_slab_sizes[slab->klass];
+		if (size <= old) {
+			(void) memset(p4_heap_site, 0, sizeof (p4_heap_site));
+			return mem;
+		}
+		if ((copy = p4HeapAlloc(size)) != NULL) {
+			(void) memcpy(copy, mem, old);
+			p4SlabUnprofile(mem);
+			p4SlabFree(slab, mem);
+		}
+		return copy;
+	}
+	/* Large or foreign memory stays with the C library. */
+	if (p4HeapReserve() != 0) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	entry = p4HeapFind(mem);
+	if ((copy = realloc(mem, size == 0 ? 1 : size)) == NULL) {
+		return NULL;
+	}
+	if (entry != NULL) {
+		p4HeapCountFree(entry->size);
+		p4HeapRemove(entry);
+	}
+	p4HeapInsertSite(copy, size);
+	p4HeapCountAlloc(size);
+	return copy;
+}
+
+void *
+p4HeapRealloc(void *mem, size_t size)
+{
+	P4_HEAP_LOCK();
+	mem = p4HeapReallocLocked(mem, size);
+	P4_HEAP_UNLOCK();
+	return mem;
+}
+
+void
+p4HeapFree(void *mem)
+{
+	P4_Slab *slab;
+	P4_Heap_Entry *entry;
+
+	if (mem == NULL) {
+		return;
+	}
+	P4_HEAP_LOCK();
+	if ((slab = p4SlabFind(mem)) != NULL) {
+		p4SlabUnprofile(mem);
+		p4SlabFree(slab, mem);
+		P4_HEAP_UNLOCK();
+		return;
+	}
+	if ((entry = p4HeapFind(mem)) != NULL) {
+		p4HeapCountFree(entry->size);
+		p4HeapRemove(entry);
+	}
+	P4_HEAP_UNLOCK();
+	free(mem);
+}
+
+/***********************************************************************
+ *** Allocation Profile
+ ***********************************************************************/
+
+void
+p4HeapProfile(unsigned frames)
+{
+	P4_HEAP_LOCK();
+	p4_heap_frames = frames < P4_HEAP_FRAMES ? frames : P4_HEAP_FRAMES;
+	p4_heap_profiled |= 0 < p4_heap_frames;
+	P4_HEAP_UNLOCK();
+}
+
+void
+p4HeapSite(const P4_Cell *ip, const P4_Stack *rs)
+{
+	if (p4_heap_frames == 0) {
+		return;
+	}
+	p4_heap_site[0] = ip;
+	for (unsigned i = 1; i < p4_heap_frames; i++) {
+		p4_heap_site[i] = (ptrdiff_t) i <= P4_PLENGTH(rs) ? rs->top[1 - (int) i].p : NULL;
+	}
+}
+
+typedef struct {
+	const P4_Word *	word[P4_HEAP_FRAMES];
+	size_t		bytes;
+	size_t		blocks;
+} P4_Heap_Group;
+
+static int
+p4WordByData(const void *a, const void *b)
+{
+	const P4_Word *x = *(const P4_Word **) a, *y = *(const P4_Word **) b;
+	return (y->data < x->data) - (x->data < y->data);
+}
+
+static int
+p4GroupBySite(const void *a, const void *b)
+{
+	return memcmp(((const P4_Heap_Group *) a)->word, ((const P4_Heap_Group *) b)->word, sizeof (((P4_Heap_Group *) a)->word));
+}
+
+static int
+p4GroupByBytes(const void *a, const void *b)
+{
+	const P4_Heap_Group *x = a, *y = b;
+	return (x->bytes < y->bytes) - (y->bytes < x->bytes);
+}
+
+/* Find the word whose body holds the address; words sorted by data. */
+static const P4_Word *
+p4WordOfAddress(P4_Word **words, size_t n, const void *addr)
+{
+	size_t lo = 0, hi = n;
+	if (addr == NULL) {
+		return NULL;
+	}
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if ((const void *) words[mid]->data <= addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (0 < lo && addr < (const void *) ((P4_Char *) words[lo-1]->data + words[lo-1]->ndata)) {
+		return words[lo-1];
+	}
+	return NULL;
+}
+
+void
+p4HeapReport(P4_Ctx *ctx, FILE *fp)
+{
+	P4_Word *w, **words = NULL;
+	P4_Heap_Group *groups = NULL;
+	size_t i, j, nwords = 0, ngroups = 0, maxgroups = p4_heap_tcount + 1;
+
+	for (i = 0; i < P4_WORDLISTS; i++) {
+		for (w = ctx->lists[i]; w != NULL; w = w->prev) {
+			nwords++;
+		}
+	}
+	if ((words = malloc((nwords + 1) * sizeof (*words))) == NULL
+	|| (groups = calloc(maxgroups, sizeof (*groups))) == NULL) {
+		goto error0;
+	}
+	nwords = 0;
+	for (i = 0; i < P4_WORDLISTS; i++) {
+		for (w = ctx->lists[i]; w != NULL; w = w->prev) {
+			if (w->data != NULL && 0 < w->ndata) {
+				words[nwords++] = w;
+			}
+		}
+	}
+	qsort(words, nwords, sizeof (*words), p4WordByData);
+
+	/* Another thread might have grown the table since. */
+	P4_HEAP_LOCK();
+	for (i = 0; i < p4_heap_tsize && ngroups < maxgroups; i++) {
+		P4_Heap_Entry *entry = &p4_heap_table[i];
+		if (entry->mem == NULL) {
+			continue;
+		}
+		for (j = 0; j < P4_HEAP_FRAMES; j++) {
+			groups[ngroups].word[j] = p4WordOfAddress(words, nwords, entry->site[j]);
+		}
+		groups[ngroups].bytes = entry->size;
+		groups[ngroups].blocks = 1;
+		ngroups++;
+	}
+	P4_HEAP_UNLOCK();
+	qsort(groups, ngroups, sizeof (*groups), p4GroupBySite);
+	for (i = j = 0; i < ngroups; i++) {
+		if (0 < j && p4GroupBySite(&groups[j-1], &groups[i]) == 0) {
+			groups[j-1].bytes += groups[i].bytes;
+			groups[j-1].blocks += groups[i].blocks;
+		} else {
+			groups[j++] = groups[i];
+		}
+	}
+	ngroups = j;
+	qsort(groups, ngroups, sizeof (*groups), p4GroupByBytes);
+
+	(void) fprintf(fp, "%12s %8s  %s" NL, "bytes", "blocks", "allocating word");
+	for (i = 0; i < ngroups; i++) {
+		(void) fprintf(fp, "%12zu %8zu  ", groups[i].bytes, groups[i].blocks);
+		if (groups[i].word[0] == NULL) {
+			(void) fprintf(fp, "?");
+		}
+		for (j = 0; j < P4_HEAP_FRAMES && groups[i].word[j] != NULL; j++) {
+			const P4_Word *word = groups[i].word[j];
+			(void) fprintf(fp, "%s%.*s", 0 < j ? " <- " : "", (int) word->length, word->length == 0 ? ":NONAME" : word->name);
+		}
+		(void) fprintf(fp, NL);
+	}
+	(void) fprintf(fp, "%12zu %8zu  live, %zu peak bytes" NL,
+		p4_heap_stats.live_bytes, p4_heap_stats.live_blocks, p4_heap_stats.peak_bytes
+	);
+error0:
+	free(groups);
+	free(words);
+}
+
+#ifdef HAVE_HOOKS
+/*
+ * heap-stats ( -- u1 u2 u3 u4 )
+ */
+static void
+p4HeapStatsHook(P4_Ctx *ctx)
+{
+	p4AllocStack(ctx, &ctx->ds, 4);
+	P4_PUSH(ctx->ds, p4_heap_stats.live_bytes);
+	P4_PUSH(ctx->ds, p4_heap_stats.live_blocks);
+	P4_PUSH(ctx->ds, p4_heap_stats.peak_bytes);
+	P4_PUSH(ctx->ds, p4_heap_stats.slab_pages);
+}
+
+/*
+ * heap-class ( u1 -- u2 u3 )
+ */
+static void
+p4HeapClass(P4_Ctx *ctx)
+{
+	P4_Size klass = P4_TOP(ctx->ds).z;
+	p4AllocStack(ctx, &ctx->ds, 1);
+	if (P4_SLAB_CLASSES <= klass || P4_SLAB_MAX < p4_slab_sizes[klass]) {
+		P4_TOP(ctx->ds).z = 0;
+		P4_PUSH(ctx->ds, (P4_Size) 0);
+		return;
+	}
+	P4_TOP(ctx->ds).z = p4_slab_sizes[klass];
+	P4_PUSH(ctx->ds, p4_heap_stats.class_live[klass]);
+}
+
+/*
+ * heap-profile ( u -- )
+ */
+static void
+p4HeapProfileHook(P4_Ctx *ctx)
+{
+	p4HeapProfile((unsigned) P4_POP(ctx->ds).u);
+}
+
+/*
+ * heap-report ( -- )
+ */
+static void
+p4HeapReportHook(P4_Ctx *ctx)
+{
+	(void) fflush(stdout);
+	p4HeapReport(ctx, stdout);
+}
+
+P4_Hook p4_heap_hooks[] = {
+	P4_HOOK(0x10, "heap-profile", p4HeapProfileHook),
+	P4_HOOK(0x00, "heap-report", p4HeapReportHook),
+	P4_HOOK(0x04, "heap-stats", p4HeapStatsHook),
+	P4_HOOK(0x12, "heap-class", p4HeapClass),
+	{ 0, 0, NULL, NULL }
+};
+#endif /* HAVE_HOOKS */
@@ -98,7 +98,10 @@ p4SystemPath(P4_Ctx *ctx)
 	P4_String str;
 	char path[PATH_MAX];
 	/* Supported by NetBSD, FreeBSD, and Linux.  Assumes procfs mounted. */
-	str.length = readlink("/proc/self/exe", path, sizeof (path));
+	ssize_t n = readlink("/proc/self/exe", path, sizeof (path) - 1);
+	/* readlink does not terminate the path. */
+	str.length = n < 0 ? 0 : n;
+	path[str.length] = '\0';
 	str.string = strdup(path);
 	P4_PUSH(ctx->ds, str.string);
 	P4_PUSH(ctx->ds, str.length);
@@ -12,20 +12,25 @@
  ***********************************************************************/
 
 static const char usage[] =
-"usage: post4 [-TV][-b file][-c file][-h size][-i file][-m size]" NL
-"             [script [args ...]]" NL
+"usage: post4 [-MPsTV][-a frames][-b file][-c file][-h size][-i file][-m size]" NL
+"             [-S file][script [args ...]]" NL
 "" NL
+"-a frames\tprofile allocations by up to 4 calling words; report at exit" NL
 "-b file\t\topen a block file" NL
 "-c file\t\tword definition file; default " P4_CORE_FILE " from $POST4_PATH" NL
 "-h size\t\thistory size in lines; default " QUOTE(ALINE_HISTORY) "" NL
 "-i file\t\tinclude file; can be repeated; searches $POST4_PATH" NL
 "-m size\t\tdata space memory in KB; default " QUOTE(P4_MEM_SIZE) "" NL
+"-M\t\treport memory usage at exit" NL
+"-P\t\tprofile word calls and times; report at exit" NL
+"-s\t\treport interpreter counters at exit; see VM-STATS" NL
+"-S file\t\tsample stacks every " QUOTE(P4_SAMPLE_USEC) " us; report at exit, write folded stacks" NL
 "-T\t\tenable tracing; see TRACE" NL
 "-V\t\tbuild and version information\r\n" NL
 "If script is \"-\", read it from standard input." NL
 ;
 
-static char *flags = "b:c:d:f:h:i:m:r:TV";
+static char *flags = "a:b:c:d:f:h:i:m:r:MPsS:TV";
 
 static P4_Ctx *ctx_main;
 
@@ -53,6 +58,35 @@ cleanup(void)
 	 * to OS anyway when the process is reaped, but it helps close
 	 * the loop on memory allocations for Valgrind.
 	 */
+	if (0 < options.alloc_frames && ctx_main != NULL) {
+		(void) fflush(stdout);
+		p4HeapReport(ctx_main, stderr);
+	}
+	if (options.mem_report && ctx_main != NULL) {
+		(void) fflush(stdout);
+		p4MemReport(ctx_main, stderr);
+	}
+	if (options.profile && ctx_main != NULL) {
+		(void) fflush(stdout);
+		p4ProfileStop(ctx_main);
+		p4ProfileReport(ctx_main, stderr);
+	}
+	if (options.sample_file != NULL && ctx_main != NULL) {
+		FILE *fp;
+		(void) fflush(stdout);
+		p4SampleStop(ctx_main);
+		p4SampleReport(ctx_main, stderr);
+		if ((fp = fopen(options.sample_file, "w")) != NULL) {
+			p4SampleFolded(ctx_main, fp);
+			(void) fclose(fp);
+		}
+	}
+#ifdef HAVE_STATS
+	if (options.stats_report && ctx_main != NULL) {
+		(void) fflush(stdout);
+		p4StatsReport(ctx_main, stderr);
+	}
+#endif
 	p4Free(ctx_main);
 	/* This is redundant too, but I like it for symmetry. */
 	sig_fini();
@@ -69,6 +103,9 @@ main(int argc, char **argv)
 			val = strtoul(optarg, NULL, 10);
 		}
 		switch (ch) {
+		case 'a':
+			options.alloc_frames = val;
+			break;
 		case 'b':
 			options.block_file = optarg;
 			break;
@@ -84,6 +121,22 @@ main(int argc, char **argv)
 		case 'm':
 			options.mem_size = val;
 			break;
+		case 'M':
+			options.mem_report = 1;
+			break;
+		case 'P':
+			options.profile = 1;
+			break;
+		case 's':
+#ifdef HAVE_STATS
+			options.stats_report = 1;
+#else
+			(void) fprintf(stderr, "post4: -s requires ./configure --enable-stats" NL);
+#endif
+			break;
+		case 'S':
+			options.sample_file = optarg;
+			break;
 		case 'T':
 			options.trace++;
 			break;
@@ -119,6 +172,12 @@ main(int argc, char **argv)
 	if ((ctx_main = p4Create(&options)) == NULL) {
 		return P4_EXIT_FAIL;
 	}
+	if (options.profile && (rc = p4EvalString(ctx_main, "profile-on", STRLEN("profile-on"))) != P4_THROW_OK) {
+		return P4_EXIT_STATUS(rc);
+	}
+	if (options.sample_file != NULL && (rc = p4EvalString(ctx_main, "0 sample-on", STRLEN("0 sample-on"))) != P4_THROW_OK) {
+		return P4_EXIT_STATUS(rc);
+	}
 
 	for (optind = 1; (ch = getopt(argc, argv, flags)) != -1; ) {
 		if (ch == 'i' && (rc = p4EvalFilePath(ctx_main, optarg)) != P4_THROW_OK) {
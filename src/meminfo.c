@@ -0,0 +1,178 @@
+/*
+ * meminfo.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+/*
+ * Built-in words are static, so only words created at run-time, with
+ * a data pointer, count towards the allocated word headers.
+ */
+static void
+p4WordHeaders(P4_Word *list, P4_Size *count, P4_Size *bytes)
+{
+	for (P4_Word *word = list; word != NULL; word = word->prev) {
+		++*count;
+		if (word->data != NULL) {
+			*bytes += sizeof (*word) + word->length + 1;
+		}
+	}
+}
+
+static P4_Size
+p4StackBytes(P4_Stack *stk)
+{
+	return stk->base == NULL ? 0 : (stk->size + P4_GUARD_CELLS) * sizeof (*stk->base);
+}
+
+void
+p4MemReport(P4_Ctx *ctx, FILE *fp)
+{
+	P4_Size count, bytes;
+	const P4_Heap_Stats *heap = p4HeapStats();
+	P4_Char *start = (P4_Char *) (ctx + 1);
+
+	(void) fprintf(fp, "data space     %10zu used %10zu reserved" NL,
+		(size_t) (ctx->here - start), (size_t) (ctx->end - start)
+	);
+	count = bytes = 0;
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		p4WordHeaders(ctx->lists[i], &count, &bytes);
+	}
+	(void) fprintf(fp, "word headers   %10zu words %9zu bytes" NL, count, bytes);
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		count = bytes = 0;
+		p4WordHeaders(ctx->lists[i], &count, &bytes);
+		if (0 < count) {
+			(void) fprintf(fp, "  word list %-3d%10zu words %9zu bytes" NL, i + 1, count, bytes);
+		}
+	}
+	(void) fprintf(fp, "stacks         %10zu ds %12zu rs %12zu fs bytes" NL,
+		p4StackBytes(&ctx->ds), p4StackBytes(&ctx->rs), p4StackBytes(&ctx->fs)
+	);
+	(void) fprintf(fp, "input frame    %10zu bytes each" NL, sizeof (*ctx->input));
+	(void) fprintf(fp, "block buffer   %10zu bytes" NL, ctx->block == NULL ? 0 : sizeof (*ctx->block));
+	(void) fprintf(fp, "heap           %10zu live %10zu blocks %8zu peak %6zu slab pages" NL,
+		heap->live_bytes, heap->live_blocks, heap->peak_bytes, heap->slab_pages
+	);
+}
+
+#ifdef HAVE_HOOKS
+
+/*
+ * data-space ( -- u1 u2 )
+ */
+static void
+p4DataSpace(P4_Ctx *ctx)
+{
+	P4_Char *start = (P4_Char *) (ctx + 1);
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, (P4_Size) (ctx->here - start));
+	P4_PUSH(ctx->ds, (P4_Size) (ctx->end - start));
+}
+
+/*
+ * word-headers ( -- u1 u2 )
+ */
+static void
+p4WordHeadersHook(P4_Ctx *ctx)
+{
+	P4_Size count = 0, bytes = 0;
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		p4WordHeaders(ctx->lists[i], &count, &bytes);
+	}
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, count);
+	P4_PUSH(ctx->ds, bytes);
+}
+
+/*
+ * wordlist-count ( wid -- u )
+ */
+static void
+p4WordlistCount(P4_Ctx *ctx)
+{
+	P4_Size count = 0, bytes = 0;
+	P4_Int wid = P4_TOP(ctx->ds).n;
+	if (wid < 0 || P4_WORDLISTS < wid) {
+		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
+	}
+	p4WordHeaders(ctx->lists[wid-1], &count, &bytes);
+	P4_TOP(ctx->ds).z = count;
+}
+
+/*
+ * stack-bytes ( -- u1 u2 u3 )
+ */
+static void
+p4StackBytesHook(P4_Ctx *ctx)
+{
+	p4AllocStack(ctx, &ctx->ds, 3);
+	P4_PUSH(ctx->ds, p4StackBytes(&ctx->ds));
+	P4_PUSH(ctx->ds, p4StackBytes(&ctx->rs));
+	P4_PUSH(ctx->ds, p4StackBytes(&ctx->fs));
+}
+
+/*
+ * memory-report ( -- )
+ */
+static void
+p4MemReportHook(P4_Ctx *ctx)
+{
+	p4MemReport(ctx, stdout);
+}
+
+static int
+p4WordBySize(const void *a, const void *b)
+{
+	const P4_Word *x = *(const P4_Word **) a, *y = *(const P4_Word **) b;
+	return (x->ndata < y->ndata) - (y->ndata < x->ndata);
+}
+
+/*
+ * words-by-size ( u -- )
+ */
+static void
+p4WordsBySize(P4_Ctx *ctx)
+{
+	P4_Word *word, **words;
+	P4_Size i, n = 0, max = P4_POP(ctx->ds).z;
+
+	for (i = 0; i < P4_WORDLISTS; i++) {
+		for (word = ctx->lists[i]; word != NULL; word = word->prev) {
+			n++;
+		}
+	}
+	if ((words = malloc((n + 1) * sizeof (*words))) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	n = 0;
+	for (i = 0; i < P4_WORDLISTS; i++) {
+		for (word = ctx->lists[i]; word != NULL; word = word->prev) {
+			if (word->data != NULL) {
+				words[n++] = word;
+			}
+		}
+	}
+	qsort(words, n, sizeof (*words), p4WordBySize);
+	for (i = 0; i < n && i < max; i++) {
+		(void) printf("%8zu  %.*s" NL, words[i]->ndata,
+			(int) words[i]->length, words[i]->length == 0 ? ":NONAME" : words[i]->name
+		);
+	}
+	free(words);
+}
+
+P4_Hook p4_meminfo_hooks[] = {
+	P4_HOOK(0x02, "data-space", p4DataSpace),
+	P4_HOOK(0x02, "word-headers", p4WordHeadersHook),
+	P4_HOOK(0x11, "wordlist-count", p4WordlistCount),
+	P4_HOOK(0x03, "stack-bytes", p4StackBytesHook),
+	P4_HOOK(0x00, "memory-report", p4MemReportHook),
+	P4_HOOK(0x10, "words-by-size", p4WordsBySize),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
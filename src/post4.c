@@ -128,6 +128,7 @@ void
 p4Init(P4_Options *opts)
 {
 	alineInit(opts->hist_size);
+	p4HeapProfile(opts->alloc_frames);
 }
 
 P4_String
@@ -708,6 +709,7 @@ p4Refill(P4_Input *input)
 	}
 	input->length = n;
 	input->offset = 0;
+	input->line++;
 	return P4_TRUE;
 }
 
@@ -737,6 +739,9 @@ p4Allot(P4_Ctx *ctx, P4_Int n)
 		(*ctx->active)->ndata += n;
 	}
 	void *start = ctx->here;
+	if (ctx->cover != NULL) {
+		p4CoverAllot(ctx, start, n);
+	}
 	ctx->here += n;
 	return start;
 }
@@ -783,6 +788,7 @@ p4FindNameIn(P4_Ctx *ctx, const char *caddr, P4_Size length, int wid)
 		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
 	}
 	for (P4_Word *word = ctx->lists[wid-1]; word != NULL; word = word->prev) {
+		P4_STATS_INC(ctx, find_compare);
 		if (!P4_WORD_IS_HIDDEN(word)
 		&& word->length > 0 && word->length == length
 		&& strncasecmp(word->name, caddr, length) == 0) {
@@ -796,6 +802,7 @@ p4FindNameIn(P4_Ctx *ctx, const char *caddr, P4_Size length, int wid)
 P4_Nt
 p4FindName(P4_Ctx *ctx, const char *caddr, P4_Size length)
 {
+	P4_STATS_INC(ctx, find_name);
 	/* Start from zero, LOCALS always included first. */
 	for (unsigned i = 0; i < ctx->norder; i++) {
 		P4_Nt nt = p4FindNameIn(ctx, caddr, length, ctx->order[i]);
@@ -803,6 +810,7 @@ p4FindName(P4_Ctx *ctx, const char *caddr, P4_Size length)
 			return nt;
 		}
 	}
+	P4_STATS_INC(ctx, find_miss);
 	return NULL;
 }
 
@@ -851,11 +859,19 @@ p4Free(P4_Ctx *ctx)
 		if (ctx->block_fd != NULL) {
 			(void) fclose(ctx->block_fd);
 		}
+		p4ScratchFree(ctx);
+		p4ProfileFree(ctx);
+		p4TraceFree(ctx);
+		p4CoverFree(ctx);
+#ifdef HAVE_STATS
+		p4StatsFree(ctx);
+#endif
 		free(ctx->ds.base - P4_GUARD_CELLS/2);
 		free(ctx->fs.base - P4_GUARD_CELLS/2);
 		free(ctx->rs.base - P4_GUARD_CELLS/2);
-		free(ctx->input);
-		free(ctx->block);
+		/* Possibly allocated by Forth, see _input_new. */
+		p4HeapFree(ctx->input);
+		p4HeapFree(ctx->block);
 		free(ctx);
 	}
 }
@@ -867,6 +883,7 @@ p4ResetInput(P4_Ctx *ctx, FILE *fp)
 	ctx->input->length = 0;
 	ctx->input->offset = 0;
 	ctx->input->blk = 0;
+	ctx->input->line = 0;
 }
 
 void
@@ -874,6 +891,7 @@ p4AllocStack(P4_Ctx *ctx, P4_Stack *stk, unsigned need)
 {
 	int depth = 0;
 	P4_Cell *base = NULL;
+	P4_STATS_INC(ctx, alloc_stack);
 	if (stk->base != NULL) {
 		depth = P4_PLENGTH(stk);
 		if (depth+need <= stk->size) {
@@ -882,7 +900,10 @@ p4AllocStack(P4_Ctx *ctx, P4_Stack *stk, unsigned need)
 		base = stk->base - P4_GUARD_CELLS/2;
 		need = P4_ALIGN_SIZE(depth + need, P4_STACK_EXTRA);
 	}
+	P4_STATS_INC(ctx, realloc_stack);
+	p4_sample_hold = 1;
 	if ((base = realloc(base, (need + P4_GUARD_CELLS) * sizeof (*stk->base))) == NULL) {
+		p4_sample_hold = 0;
 		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
 	}
 	/* Adjust base for underflow guard. */
@@ -893,6 +914,7 @@ p4AllocStack(P4_Ctx *ctx, P4_Stack *stk, unsigned need)
 	stk->base[-2].u = 0;
 	stk->size = need;
 	P4_PSET(stk, depth);
+	p4_sample_hold = 0;
 }
 
 static P4_Input *
@@ -997,10 +1019,21 @@ p4TraceStack(P4_Ctx *ctx, P4_Stack *stk, int u, const char *prefix)
 }
 #pragma GCC diagnostic pop
 
+/* Only called while ctx->trace is set, so _next tests a single field. */
 static void
-p4Trace(P4_Ctx *ctx, P4_Xt xt, P4_Cell *ip)
+p4Trace(P4_Ctx *ctx, P4_Xt xt, P4_Cell *ip, P4_Cell top)
 {
-	if (ctx->trace) {
+	if (ctx->cover != NULL) {
+		p4CoverMark(ctx, xt, ip, top);
+	}
+	if (ctx->trace == P4_TRACE_HOOKS) {
+		if (0 < ctx->traced) {
+			p4TraceWord(ctx, xt, ip);
+		}
+	} else {
+		if (p4TraceRecord(ctx, xt, ip)) {
+			return;
+		}
 #ifdef HAVE_MATH_H
 		(void) fprintf(
 			STDERR, "ds=%-2d fs=%-2d rs=%-2d %*s%s ",
@@ -1031,7 +1064,7 @@ p4Trace(P4_Ctx *ctx, P4_Xt xt, P4_Cell *ip)
 #else
 # define p4Bp(ctx)
 # define p4Cp(ctx)
-# define p4Trace(ctx, xt, ip)
+# define p4Trace(ctx, xt, ip, top)
 #endif
 
 /* When compiled with debugging add more selective and frequent stack checks. */
@@ -1184,12 +1217,18 @@ p4CoreFile(P4_Ctx *ctx)
 	return rc;
 }
 
-int
-p4Repl(P4_Ctx *ctx, volatile int thrown)
+/*
+ * When call is NULL, run the REPL reading from the current input.
+ * Otherwise execute the single xt call and return to the C caller,
+ * see p4Call().
+ */
+static int
+p4Run(P4_Ctx *ctx, volatile int thrown, P4_Xt call)
 {
 	int rc;
 	P4_String str;
 	P4_Cell w, x, y, *ip;
+	P4_Cell call_ip[2];
 
 #pragma GCC diagnostic push
 /* Ignore pedantic warning about "address of a label", required extension. */
@@ -1258,8 +1297,10 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 		P4_WORD("F/",		&&_f_div,	0, 0x210000),
 		P4_WORD("F0<",		&&_f_lt0,	0, 0x110000),
 		P4_WORD("F0=",		&&_f_eq0,	0, 0x110000),
+		P4_WORD("FE.",		&&_f_edot,	0, 0x100000),
 		P4_WORD("FS.",		&&_f_sdot,	0, 0x100000),
 		P4_WORD("F.",		&&_f_dot,	0, 0x100000),
+		P4_WORD("f>string",	&&_f_to_string,	0, 0x100002),	// p4
 		P4_WORD("REPRESENT",	&&_f_represent,	0, 0x100023),
 		P4_WORD("F>S",		&&_f_to_s,	0, 0x100001),
 		P4_WORD("S>F",		&&_s_to_f,	0, 0x010010),
@@ -1373,6 +1414,15 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 		/* Tools*/
 		P4_WORD("alias",	&&_alias,	0, 0x10),	// p4
 		P4_WORD("bye-status",	&&_bye_code,	0, 0x10),	// p4
+		P4_WORD("profile-off",	&&_profile_off,	0, 0x00),	// p4
+		P4_WORD("profile-on",	&&_profile_on,	0, 0x00),	// p4
+		P4_WORD("profile-report", &&_profile_report, 0, 0x00),	// p4
+		P4_WORD("profile-reset", &&_profile_reset, 0, 0x00),	// p4
+		P4_WORD("sample-folded", &&_sample_folded, 0, 0x21),	// p4
+		P4_WORD("sample-off",	&&_sample_off,	0, 0x00),	// p4
+		P4_WORD("sample-on",	&&_sample_on,	0, 0x10),	// p4
+		P4_WORD("sample-report", &&_sample_report, 0, 0x00),	// p4
+		P4_WORD("sample-reset",	&&_sample_reset, 0, 0x00),	// p4
 
 		/* I/O */
 		P4_WORD("ACCEPT",	&&_accept,	0, 0x21),
@@ -1392,7 +1442,8 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 
 #define NEXT		goto _next
 #define THROWHARD(e)	{ rc = (e); goto _thrown; }
-#define THROW(e)	{ if (p4_throw != NULL) { x.nt = p4_throw; \
+#define THROW(e)	{ P4_STATS_INC(ctx, throws); \
+			if (p4_throw != NULL) { x.nt = p4_throw; \
 				P4_PUSH(ctx->ds, (P4_Int)(e)); \
 				/* Reset any previous exception. */ \
 				rc = P4_THROW_OK; goto _forth; \
@@ -1413,6 +1464,24 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 		/* Find _hook_call and install any hooked words, eg. SH SHELL. */
 		p4_hook_call = p4FindName(ctx, "_hook_call", STRLEN("_hook_call"));
 		p4HookInit(ctx, p4_hooks);
+		p4HookInit(ctx, p4_sort_hooks);
+		p4HookInit(ctx, p4_bitset_hooks);
+		p4HookInit(ctx, p4_pqueue_hooks);
+		p4HookInit(ctx, p4_arena_hooks);
+		p4HookInit(ctx, p4_heap_hooks);
+		p4HookInit(ctx, p4_meminfo_hooks);
+		p4HookInit(ctx, p4_random_hooks);
+		p4HookInit(ctx, p4_cvec_hooks);
+		p4HookInit(ctx, p4_bignum_hooks);
+		p4HookInit(ctx, p4_clock_hooks);
+		p4HookInit(ctx, p4_trace_hooks);
+		p4HookInit(ctx, p4_cover_hooks);
+#ifdef HAVE_STATS
+		p4HookInit(ctx, p4_stats_hooks);
+#endif
+# ifdef HAVE_MATH_H
+		p4HookInit(ctx, p4_fvec_hooks);
+# endif
 #endif
 		if ((rc = p4CoreFile(ctx)) != P4_THROW_OK) {
 			THROWHARD(rc);
@@ -1428,8 +1497,8 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 #pragma GCC diagnostic push
 /* Ignore pedantic warning about "address of a label", required extension. */
 #pragma GCC diagnostic ignored "-Wpedantic"
-	static const P4_Word w_inter_loop = P4_WORD("_inter_loop", &&_inter_loop, P4_BIT_HIDDEN, 0x00);
-	static const P4_Word w_halt = P4_WORD("_halt", &&_halt, P4_BIT_HIDDEN, 0x00);
+	static P4_Word w_inter_loop = P4_WORD("_inter_loop", &&_inter_loop, P4_BIT_HIDDEN, 0x00);
+	static P4_Word w_halt = P4_WORD("_halt", &&_halt, P4_BIT_HIDDEN, 0x00);
 	static const P4_Cell repl[] = { {.cw = &w_interpret}, {.cw = &w_halt} };
 
 	/* When the REPL executes a word, it puts the XT of the word here
@@ -1441,7 +1510,27 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 #pragma GCC diagnostic pop
 
 	SETJMP_PUSH(ctx->longjmp);
+	P4_STATS_INC(ctx, setjmp);
+	if (call != NULL) {
+		/* Nested calls from C never longjmp from a signal handler,
+		 * so skip the cost of saving the signal mask, which for
+		 * something like SORT's comparator adds up quickly.
+		 */
+		rc = SIGSETJMP(ctx->longjmp, 0);
+		if (rc != P4_THROW_OK) {
+			P4_STATS_INC(ctx, longjmp);
+			/* Let the C caller clean-up and rethrow. */
+			goto _halt;
+		}
+		call_ip[0].xt = call;
+		call_ip[1].cw = &w_halt;
+		ip = call_ip;
+		NEXT;
+	}
 	rc = SETJMP(ctx->longjmp);
+	if (rc != P4_THROW_OK) {
+		P4_STATS_INC(ctx, longjmp);
+	}
 
 	if (thrown != P4_THROW_OK) {
 		/* Signal thrown overrides context. */
@@ -1454,6 +1543,9 @@ p4Repl(P4_Ctx *ctx, volatile int thrown)
 		THROW(rc);
 	}
 _thrown:
+	if (call != NULL) {
+		goto _halt;
+	}
 	switch (rc) {
 	default:
 		p4Bp(ctx);
@@ -1502,6 +1594,8 @@ _abort:		P4_RESET(ctx->ds);
 		/*@fallthrough@*/
 	case P4_THROW_QUIT:
 _quit:		P4_RESET(ctx->rs);
+		/* Return stack marks are gone, release all scratch. */
+		p4ScratchReset(ctx);
 		(void) fflush(STDERR);
 		p4ResetInput(ctx, stdin);
 		ctx->state = P4_STATE_INTERPRET;
@@ -1523,18 +1617,25 @@ _interpret:
 		 * so try to parse it first before reading more input.
 		 */
 _inter_loop:	while (ctx->input->offset < ctx->input->length) {
+			P4_STATS_PHASE(ctx, P4_PHASE_PARSE);
 			str = p4ParseName(ctx->input);
 			if (str.length == 0) {
 				break;
 			}
+			P4_STATS_PHASE(ctx, P4_PHASE_FIND);
 			x.nt = p4FindName(ctx, str.string, str.length);
 			if (x.nt == NULL) {
 				P4_Cell num[2];
 				int is_float, is_double;
+				P4_STATS_INC(ctx, str_num);
+				P4_STATS_PHASE(ctx, P4_PHASE_NUMBER);
 				if (p4StrNum(str, ctx->radix, num, &is_float, &is_double)) {
 					/* Not a word, not a number. */
 					THROW(P4_THROW_UNDEFINED);
 				}
+				if (ctx->state == P4_STATE_COMPILE) {
+					P4_STATS_PHASE(ctx, P4_PHASE_COMPILE);
+				}
 #ifdef HAVE_MATH_H
 				if (is_float) {
 					if (ctx->state == P4_STATE_COMPILE) {
@@ -1572,13 +1673,16 @@ _inter_loop:	while (ctx->input->offset < ctx->input->length) {
 			} else if (ctx->state == P4_STATE_INTERPRET && P4_WORD_IS(x.nt, P4_BIT_COMPILE)) {
 				THROW(P4_THROW_COMPILE_ONLY);
 			} else if (ctx->state == P4_STATE_COMPILE && !P4_WORD_IS_IMM(x.nt)) {
+				P4_STATS_PHASE(ctx, P4_PHASE_COMPILE);
 				p4WordAppend(ctx, (P4_Cell) x.nt);
 			} else {
+				P4_STATS_PHASE(ctx, P4_PHASE_EXECUTE);
 _forth:				exec[0].xt = x.nt;
 				ip = exec;
 				NEXT;
 			}
 		}
+		P4_STATS_PHASE(ctx, P4_PHASE_NONE);
 		if (P4_INTERACTIVE(ctx)) {
 			/* GH-96 Add leading space to prompt.  While colour
 			 * helps visually, terminal copy/paste does not have
@@ -1604,18 +1708,25 @@ _nop:
 _next:		w = *ip++;
 		/* Pre-load top for some words. */
 		x = P4_TOP(ctx->ds);
-		p4Trace(ctx, w.xt, ip);
+		if (ctx->trace) {
+			p4Trace(ctx, w.xt, ip, x);
+		}
+		P4_STATS_WORD(w.xt);
 		goto *w.xt->code;
 
 		// ( xt -- )
 _execute:	w = P4_POP(ctx->ds);
 		/* Pre-load top for some words. */
 		x = P4_TOP(ctx->ds);
-		p4Trace(ctx, w.xt, ip);
+		if (ctx->trace) {
+			p4Trace(ctx, w.xt, ip, x);
+		}
+		P4_STATS_WORD(w.xt);
 		goto *w.xt->code;
 
 		// ( i*x -- j*y )(R: -- ip)
-_enter:		p4AllocStack(ctx, &ctx->rs, 1);
+_enter:		P4_STATS_INC(ctx, enter);
+		p4AllocStack(ctx, &ctx->rs, 1);
 		P4_PUSH(ctx->rs, ip);
 		// w contains xt loaded by _next or _execute.
 		ip = w.xt->data;
@@ -1623,11 +1734,22 @@ _enter:		p4AllocStack(ctx, &ctx->rs, 1);
 		NEXT;
 
 		// ( i*x -- i*x )(R:ip -- )
-_exit:		P4STACKGUARDS(ctx);
+_exit:		P4_STATS_INC(ctx, exit);
+		P4STACKGUARDS(ctx);
 		ip = P4_POP(ctx->rs).p;
 		ctx->level--;
 		NEXT;
 
+		/* While profiling, see PROFILE-ON. */
+_enter_prof:	p4ProfileEnter(ctx, w.xt, w.xt->data);
+		goto _enter;
+
+_exit_prof:	p4ProfileExit(ctx);
+		goto _exit;
+
+_do_does_prof:	p4ProfileEnter(ctx, w.xt, w.xt->data[0].p);
+		goto _do_does;
+
 		// ( ex_code -- )
 _bye_code:	exit((int) x.n);
 
@@ -1706,10 +1828,10 @@ _colon:		str = p4ParseName(ctx->input);
 		// (C: -- colon) (R: -- ip)
 		// Save the current lengths so we can check for imbalance.
 _do_colon:	ctx->state = P4_STATE_COMPILE;
-		if (ctx->trace) {
+		if (ctx->trace && ctx->trace != P4_TRACE_HOOKS && !p4TraceBinary(ctx)) {
 			(void) printf("%*s%.*s" NL, 19+2*(int)ctx->level, "", (int)str.length, str.string);
 		}
-		x.nt = p4WordCreate(ctx, str.string, str.length, &&_enter);
+		x.nt = p4WordCreate(ctx, str.string, str.length, p4Profiling(ctx) ? &&_enter_prof : &&_enter);
 		p4AllocStack(ctx, &ctx->ds, 1+(x.nt->length == 0));
 		if (x.nt->length == 0) {
 			/* :NONAME leaves xt on stack. */
@@ -1795,7 +1917,7 @@ _does:		w.nt = *ctx->active;
 		if (!P4_WORD_IS(w.nt, P4_BIT_CREATED)) {
 			THROW(P4_THROW_NOT_CREATED);
 		}
-		w.nt->code = &&_do_does;
+		w.nt->code = p4Profiling(ctx) ? &&_do_does_prof : &&_do_does;
 		/*** If we change (again) how a P4_Word and data are
 		 *** stored in memory, then most likely need to fix
 		 *** this and _seext.
@@ -1809,10 +1931,12 @@ _does:		w.nt = *ctx->active;
 		//	: word CREATE ( store data) DOES> ( words) ;
 		//	                                  ^--- IP
 		w.nt->data[0].p = ip;
+		p4ProfileExit(ctx);
 		goto _exit;
 
 		// ( -- aaddr)
-_do_does:	p4AllocStack(ctx, &ctx->ds, 1);
+_do_does:	P4_STATS_INC(ctx, enter);
+		p4AllocStack(ctx, &ctx->ds, 1);
 		P4_PUSH(ctx->ds, w.xt->data + 1);
 		// Remember who called us.
 		p4AllocStack(ctx, &ctx->rs, 1);
@@ -1900,7 +2024,7 @@ _here_offset:	P4_PUSH(ctx->ds, (P4_Size)(ctx->here - (P4_Char *) (*ctx->active)-
 		 * Dynamic Memory
 		 */
 		// ( aaddr -- ior )
-_free:		free(x.s);
+_free:		p4HeapFree(x.s);
 		P4_TOP(ctx->ds).n = 0;
 		NEXT;
 
@@ -1926,7 +2050,8 @@ _resize_null:	if (x.n < 0 && -1024 <= x.n) {
 			NEXT;
 		}
 		errno = 0;
-		x.s = realloc(w.s, (size_t) x.u);
+		p4HeapSite(ip, &ctx->rs);
+		x.s = p4HeapRealloc(w.s, (size_t) x.u);
 		P4_TOP(ctx->ds) = x.s == NULL ? w : x;
 		P4_PUSH(ctx->ds, (P4_Int) errno);
 		NEXT;
@@ -2211,6 +2336,61 @@ _rs:		w.n = P4_LENGTH(ctx->rs);
 _stack_check:	p4StackGuards(ctx);
 		NEXT;
 
+		/*
+		 * The code field of colon definitions, DOES> words, and
+		 * EXIT swap between the plain and profiling entry points,
+		 * so the inner interpreter is unchanged when not profiling.
+		 */
+		static void *const plain_code[] = { &&_enter, &&_do_does, &&_exit };
+		static void *const prof_code[] = { &&_enter_prof, &&_do_does_prof, &&_exit_prof };
+
+		// ( -- )
+_profile_on:	if (p4ProfileStart(ctx)) {
+			THROW(P4_THROW_ALLOCATE);
+		}
+		goto _profile_swap;
+
+		// ( -- )
+_profile_off:	p4ProfileStop(ctx);
+		goto _profile_swap;
+
+		// ( -- )
+_profile_report: (void) fflush(stdout);
+		p4ProfileReport(ctx, stdout);
+		NEXT;
+
+		// ( -- )
+_profile_reset:	p4ProfileReset(ctx);
+		NEXT;
+
+		// ( usec -- )
+_sample_on:	P4_DROP(ctx->ds, 1);
+		if (p4SampleStart(ctx, x.u)) {
+			THROW(P4_THROW_UNSUPPORTED);
+		}
+		goto _profile_swap;
+
+		// ( -- )
+_sample_off:	p4SampleStop(ctx);
+		goto _profile_swap;
+
+		// ( -- )
+_sample_report:	(void) fflush(stdout);
+		p4SampleReport(ctx, stdout);
+		NEXT;
+
+		// ( -- )
+_sample_reset:	p4SampleReset(ctx);
+		NEXT;
+
+		// Either entry points for the profiler, sampler, or not.
+_profile_swap:	if (p4Profiling(ctx)) {
+			p4ProfileSwap(ctx, plain_code, prof_code, 3);
+		} else {
+			p4ProfileSwap(ctx, prof_code, plain_code, 3);
+		}
+		NEXT;
+
 		// ( addr u -- )
 _stack_dump:	P4_DROP(ctx->ds, 1);
 		w = P4_POP(ctx->ds);
@@ -2247,6 +2427,22 @@ _fa_stdin:	P4_PUSH(ctx->ds, (void *) stdin);
 _fa_stdout:	P4_PUSH(ctx->ds, (void *) stdout);
 		NEXT;
 
+		// ( caddr u -- ior )
+_sample_folded:	w = P4_DROPTOP(ctx->ds);
+		w.s = strndup(w.s, x.z);
+		x.n = -1;
+		if (w.s != NULL && (fp = fopen(w.s, "w")) != NULL) {
+			p4SampleFolded(ctx, fp);
+			x.n = ferror(fp) ? -1 : 0;
+			if (fclose(fp) != 0) {
+				x.n = -1;
+			}
+		}
+		free(w.s);
+		/* errno is only meaningful after a failed call. */
+		P4_TOP(ctx->ds).n = x.n == 0 ? 0 : errno;
+		NEXT;
+
 		// ( fam1 -- fam2 )
 _fa_bin:	P4_TOP(ctx->ds).u = x.u | 2;
 		NEXT;
@@ -2445,27 +2641,42 @@ _to_float:	errno = 0;
 		NEXT;
 
 		// (F: f -- )
-_f_dot:		p4StackIsEmpty(ctx, &ctx->fs, P4_THROW_FS_UNDER);
+		char num[P4_FLOAT_BUFFER];
+		int E, style;
+_f_dot:		style = 'F';
+		goto f_print;
+		// (F: f -- )
+_f_sdot:	style = 'E';
+		goto f_print;
+		// (F: f -- )
+_f_edot:	style = 'e';
+f_print:	p4StackIsEmpty(ctx, &ctx->fs, P4_THROW_FS_UNDER);
 		w = P4_POP(ctx->P4_FLOAT_STACK);
-		(void) printf(P4_FLT_PRE_FMT" ", (int) ctx->precision, w.f);
+		if (p4FloatFormat(num, w.f, (int) ctx->precision, style) < (int) sizeof (num)) {
+			(void) fputs(num, stdout);
+			(void) fputc(' ', stdout);
+		} else {
+			(void) printf(style == 'F' ? P4_FLT_PRE_FMT" " : P4_SCI_PRE_FMT" ", (int) ctx->precision, w.f);
+		}
 		NEXT;
 
-		// (F: f -- )
-_f_sdot:	p4StackIsEmpty(ctx, &ctx->fs, P4_THROW_FS_UNDER);
+		// (F: f -- )( -- caddr u )
+		/* Transient like pictured numeric output, see #>. */
+		static char fstr[P4_FLOAT_STRING];
+_f_to_string:	p4StackIsEmpty(ctx, &ctx->fs, P4_THROW_FS_UNDER);
 		w = P4_POP(ctx->P4_FLOAT_STACK);
-		(void) printf(P4_SCI_PRE_FMT" ", (int) ctx->precision, w.f);
+		x.z = p4FloatString(fstr, w.f);
+		p4AllocStack(ctx, &ctx->ds, 2);
+		P4_PUSH(ctx->ds, fstr);
+		P4_PUSH(ctx->ds, x);
 		NEXT;
 
 		// (F: f -- )(S: caddr u -- n sign ok )
 		//
-		char num[DECIMAL_DIG+STRLEN(".e-999")+1];
-_f_represent:	P4_DROP(ctx->ds, 1);
+_f_represent:	p4StackIsEmpty(ctx, &ctx->fs, P4_THROW_FS_UNDER);
+		P4_DROP(ctx->ds, 1);
 		w = P4_POP(ctx->ds);
 		y = P4_POP(ctx->P4_FLOAT_STACK);
-		(void) snprintf(num, sizeof (num), P4_SCI_PRE_FMT, (int) x.n, fabs(y.f));
-		int E = strcspn(num, "eE");
-		num[E] = '\0';
-		E = (int) strtol(num+E+1, NULL, 10);
 		/* 12.6.1.2143 REPRESENT
 		 * ... The character string shall consist of the u most
 		 * significant digits of the significand represented as
@@ -2474,19 +2685,27 @@ _f_represent:	P4_DROP(ctx->ds, 1);
 		 * only if all digits are zero.
 		 *
 		 * So not 1.2345e02, but 0.12345e03 => 123450 n=3 0 -1
+		 *
+		 * The digits are those of printf("%.*E", u, f), ie. u+1
+		 * rounded digits of which the first u are kept.
 		 */
-		char *fraction = num+2;
-		if (isdigit(*num) && *num != '0') {
-			/* Shuffle leading integer digit, eg. 1.2345 -> .12345 */
-			fraction = num+1;
-			num[1] = num[0];
-			E++;
-		}
-		(void) memmove(w.s, fraction, x.z);
+		E = 0;
+		if (isfinite(y.f)) {
+			int p = x.n < P4_FLOAT_MAXDIG ? (int) x.n + 1 : P4_FLOAT_MAXDIG;
+			p4FloatDigits(fabs(y.f), p, num, &E);
+			if (p <= x.n) {
+				/* Pad in the caller's buffer; u can exceed num[]. */
+				(void) memmove(w.s, num, p);
+				(void) memset(w.s + p, '0', x.n - p);
+			} else {
+				(void) memmove(w.s, num, x.z);
+			}
+			E += *num != '0';
+		}
 		p4AllocStack(ctx, &ctx->ds, 1);
 		P4_PUSH(ctx->ds, (P4_Int) E);
 		P4_PUSH(ctx->ds, P4_BOOL(y.n < 0));
-		P4_PUSH(ctx->ds, P4_BOOL(isdigit(*num) != 0));
+		P4_PUSH(ctx->ds, P4_BOOL(isfinite(y.f)));
 		NEXT;
 
 		// (F: f1 f2 -- f3 )
@@ -2676,6 +2895,34 @@ _f_pow:		w = P4_POP(ctx->P4_FLOAT_STACK);
 #endif
 }
 
+int
+p4Repl(P4_Ctx *ctx, int thrown)
+{
+	return p4Run(ctx, thrown, NULL);
+}
+
+int
+p4Call(P4_Ctx *ctx, P4_Xt xt)
+{
+	int rc;
+	P4_Int level = ctx->level;
+	P4_Cell *frame = ctx->frame;
+	ptrdiff_t rdepth = P4_LENGTH(ctx->rs);
+
+	/* Hide any CATCH frame from the called word, otherwise THROW
+	 * would unwind into the caller's threaded code while still on
+	 * this C stack frame.  Exceptions return here instead.
+	 */
+	ctx->frame = NULL;
+	rc = p4Run(ctx, P4_THROW_OK, xt);
+	ctx->frame = frame;
+	if (rc != P4_THROW_OK) {
+		P4_SET(ctx->rs, rdepth);
+		ctx->level = level;
+	}
+	return rc;
+}
+
 int
 p4EvalFile(P4_Ctx *ctx, const char *file)
 {
@@ -81,6 +81,10 @@ extern "C" {
 #define P4_WORDLISTS			12
 #endif
 
+#ifndef P4_SAMPLE_USEC
+#define P4_SAMPLE_USEC			1000		/* in microseconds */
+#endif
+
 #ifndef P4_CORE_PATH
 /* Path list of potential package library directories where the core
  * file and friends can be found.  Used to include /usr/lib/post4,
@@ -106,6 +110,13 @@ extern "C" {
 #define P4_TRACE			1
 #endif
 
+#ifndef P4_SLAB_MAX
+/* Largest ALLOCATE request served from a slab, at most 512; 0 to
+ * disable slabs and pass all requests through to malloc.
+ */
+#define P4_SLAB_MAX			512		/* in bytes */
+#endif
+
 #ifdef WITH_JAVA
 #define HAVE_HOOKS			1
 #endif
@@ -295,6 +306,11 @@ typedef struct {
 	P4_Uint hist_size;
 	const char *core_file;
 	const char *block_file;
+	P4_Uint alloc_frames;
+	P4_Int mem_report;
+	P4_Int profile;
+	const char *sample_file;
+	P4_Int stats_report;
 } P4_Options;
 
 typedef struct {
@@ -309,6 +325,7 @@ typedef struct {
 	P4_Size		offset;		/* Offset of unconsumed input. */
 	const char *	path;
 	char *		buffer;
+	P4_Uint		line;		/* Lines read by p4Refill(). */
 	char		data[P4_INPUT_SIZE];
 } P4_Input;
 
@@ -362,6 +379,12 @@ struct p4_word {
 #define P4_BIT_CREATED			0x0002
 #define P4_BIT_HIDDEN			0x0004
 #define P4_BIT_COMPILE			0x0008
+#define P4_BIT_TRACE			0x0010
+
+/* ctx->trace while only TRACE-WORD or COVERAGE-ON watch _next; any
+ * other non-zero value traces every word.
+ */
+#define P4_TRACE_HOOKS			2
 
 #define P4_WORD_IS(w, bit)		(((w)->bits & (bit)) == (bit))
 #define P4_WORD_SET(w, bit)		((w)->bits |= (bit))
@@ -379,6 +402,10 @@ struct p4_word {
 #define P4_WORD_SET_COMPILE(w)		P4_WORD_SET(w, P4_BIT_COMPILE)
 #define P4_WORD_CLEAR_COMPILE(w)	P4_WORD_CLEAR(w, P4_BIT_COMPILE)
 
+#define P4_WORD_IS_TRACE(w)		P4_WORD_IS(w, P4_BIT_TRACE)
+#define P4_WORD_SET_TRACE(w)		P4_WORD_SET(w, P4_BIT_TRACE)
+#define P4_WORD_CLEAR_TRACE(w)		P4_WORD_CLEAR(w, P4_BIT_TRACE)
+
 	P4_Uint		poppush;
 
 #define P4_WD_LIT(w)			(((w)->poppush >> 24) & 0x0F)
@@ -394,6 +421,9 @@ struct p4_word {
 	P4_Code		code;		/* Code field points of primative. */
 	P4_Size		ndata;		/* Size of data[] in bytes. */
 	P4_Cell *	data;		/* Word grows by data cells. */
+#ifdef HAVE_STATS
+	P4_Uint		count;		/* Executions, see VM-STATS */
+#endif
 };
 
 #define P4_WORD(name, code, bits, pp)	{ NULL, STRLEN(name), name, bits, pp, code, 0 }
@@ -428,12 +458,64 @@ typedef enum {
 	P4_STATE_INTERPRET,
 } P4_State;
 
+#ifdef HAVE_STATS
+/*
+ * Outer interpreter phases, timed and counted per source file.
+ */
+typedef enum {
+	P4_PHASE_NONE,			/* Not charged, eg. REFILL */
+	P4_PHASE_PARSE,			/* p4ParseName() */
+	P4_PHASE_FIND,			/* p4FindName() */
+	P4_PHASE_NUMBER,		/* p4StrNum() */
+	P4_PHASE_COMPILE,		/* p4WordAppend() */
+	P4_PHASE_EXECUTE,		/* Interpret or immediate words. */
+	P4_PHASES
+} P4_Phase;
+
+typedef struct p4_phase_file {
+	struct p4_phase_file *next;
+	char *		path;
+	uint64_t	ns[P4_PHASES];
+	P4_Uint		count[P4_PHASES];
+} P4_Phase_File;
+
+/*
+ * Inner and outer interpreter counters, see VM-STATS.  Configure with
+ * --enable-stats, otherwise compiled out.
+ */
+typedef struct {
+	P4_Uint		enter;		/* Colon and DOES> calls. */
+	P4_Uint		exit;
+	P4_Uint		alloc_stack;	/* p4AllocStack() calls. */
+	P4_Uint		realloc_stack;	/* ... that (re)allocated. */
+	P4_Uint		find_name;	/* p4FindName() calls. */
+	P4_Uint		find_compare;	/* Words examined by p4FindNameIn(). */
+	P4_Uint		find_miss;	/* p4FindName() not found. */
+	P4_Uint		str_num;	/* p4StrNum() calls. */
+	P4_Uint		setjmp;		/* p4Run() entries. */
+	P4_Uint		longjmp;	/* ... returned to by LONGJMP. */
+	P4_Uint		throws;		/* Exceptions raised by p4Run(). */
+	P4_Phase	phase;		/* Current outer interpreter phase, */
+	uint64_t	phase_ns;	/* ... since when, */
+	P4_Phase_File *	phase_file;	/* ... and for which source. */
+	P4_Phase_File *	files;
+} P4_Stats;
+
+# define P4_STATS_INC(ctx, n)		((ctx)->stats.n++)
+# define P4_STATS_WORD(xt)		((xt)->count++)
+# define P4_STATS_PHASE(ctx, p)		p4StatsPhase(ctx, p)
+#else
+# define P4_STATS_INC(ctx, n)
+# define P4_STATS_WORD(xt)
+# define P4_STATS_PHASE(ctx, p)
+#endif
+
 struct p4_ctx {
 	P4_Char *	end;		/* End of data space memory. */
 	P4_Char *	here;		/* Next unused data space. */
 	P4_Int		state;
 	P4_Cell *	frame;		/* See CATCH and THROW. */
-	P4_Int          trace;          /* Word trace for debugging. */
+	P4_Int          trace;          /* Word trace for debugging, see P4_TRACE_HOOKS. */
 	P4_Int		level;		/* Tracing depth. */
 	P4_Uint		radix;		/* Input/Output radix */
 	P4_Stack	ds;		/* Data stack */
@@ -454,6 +536,15 @@ struct p4_ctx {
 	P4_Options *	options;
 	/* Leave this in place even if JNI support is disabled. */
 	void *		jenv;
+	void *		scratch;	/* See WITH-SCRATCH */
+	uint64_t	random[4];	/* See RANDOM */
+	void *		profile;	/* See PROFILE-ON */
+	void *		tracer;		/* See TRACE-ON */
+	void *		cover;		/* See COVERAGE-ON */
+	P4_Uint		traced;		/* Words with P4_BIT_TRACE, see TRACE-WORD */
+#ifdef HAVE_STATS
+	P4_Stats	stats;		/* See VM-STATS */
+#endif
 	/* ... */
 	JMP_BUF		longjmp;	/* Must be last in struct; size can
 					 * vary by CPU and implementation.
@@ -614,6 +705,24 @@ extern void p4Free(P4_Ctx *ctx);
  */
 extern int p4Repl(P4_Ctx *ctx, int code);
 
+/**
+ * Execute a word from C, eg. a hook calling back into Forth.  The
+ * caller passes and collects arguments on the context's stacks.
+ *
+ * @param ctx
+ *	A pointer to an allocated P4_Ctx structure.
+ *
+ * @param xt
+ *	The execution token of the word to execute.
+ *
+ * @return
+ *	Zero on success, otherwise an exception code.  The return
+ *	stack is restored, but the data and float stacks are not.
+ *	The caller should release any resources and rethrow with
+ *	LONGJMP(ctx->longjmp, rc).
+ */
+extern int p4Call(P4_Ctx *ctx, P4_Xt xt);
+
 /**
  * @param ctx
  *	A pointer to an allocated P4_Ctx structure.
@@ -664,13 +773,35 @@ extern void sig_fini(void);
 
 #ifdef HAVE_HOOKS
 extern P4_Hook p4_hooks[];
+extern P4_Hook p4_sort_hooks[];
+extern P4_Hook p4_bitset_hooks[];
+extern P4_Hook p4_pqueue_hooks[];
+extern P4_Hook p4_arena_hooks[];
+extern P4_Hook p4_heap_hooks[];
+extern P4_Hook p4_meminfo_hooks[];
+extern P4_Hook p4_random_hooks[];
+extern P4_Hook p4_cvec_hooks[];
+extern P4_Hook p4_bignum_hooks[];
+extern P4_Hook p4_clock_hooks[];
+extern P4_Hook p4_trace_hooks[];
+extern P4_Hook p4_cover_hooks[];
+# ifdef HAVE_STATS
+extern P4_Hook p4_stats_hooks[];
+# endif
+# ifdef HAVE_MATH_H
+extern P4_Hook p4_fvec_hooks[];
+# endif
 extern P4_Word *p4_hook_call;
 extern void p4HookInit(P4_Ctx *ctx, P4_Hook *hooks);
 extern P4_Word *p4HookAdd(P4_Ctx *ctx, P4_Hook *hook);
 # define P4_HOOK(pp, name, func)	{ STRLEN(name), pp, name, func }
+extern void p4ScratchReset(P4_Ctx *ctx);
+extern void p4ScratchFree(P4_Ctx *ctx);
 #else
 # define p4HookAdd(ctx, hook)		(NULL)
 # define p4HookInit(ctx, hooks)
+# define p4ScratchReset(ctx)
+# define p4ScratchFree(ctx)
 #endif
 
 /***********************************************************************
@@ -679,6 +810,318 @@ extern P4_Word *p4HookAdd(P4_Ctx *ctx, P4_Hook *hook);
 
 extern void p4ResetInput(P4_Ctx *ctx, FILE *fp);
 
+#define P4_SLAB_CLASSES		16
+
+typedef struct {
+	size_t		live_bytes;
+	size_t		live_blocks;
+	size_t		peak_bytes;
+	size_t		slab_pages;
+	size_t		class_live[P4_SLAB_CLASSES];
+} P4_Heap_Stats;
+
+/**
+ * Like realloc(3) for ALLOCATE and RESIZE.  Small requests are served
+ * from size-class slabs.  On failure returns NULL with errno set and
+ * the original memory unchanged.  The heap is shared by all contexts
+ * and serialised by a lock, which needs C11 atomics; without them only
+ * one thread may use Post4.
+ */
+extern void *p4HeapRealloc(void *mem, size_t size);
+
+/**
+ * Like free(3) for FREE; also accepts memory from the C library.
+ */
+extern void p4HeapFree(void *mem);
+
+/**
+ * @return
+ *	Current dynamic memory counters.
+ */
+extern const P4_Heap_Stats *p4HeapStats(void);
+
+/**
+ * @param frames
+ *	Record up to this many calling words for each new allocation,
+ *	at most 4; zero (0) stops profiling.
+ */
+extern void p4HeapProfile(unsigned frames);
+
+/**
+ * Note the allocation site for the next p4HeapRealloc(), when profiling.
+ *
+ * @param ip
+ *	The instruction pointer of the word calling ALLOCATE or RESIZE.
+ *
+ * @param rs
+ *	The return stack holding the callers' return addresses.
+ */
+extern void p4HeapSite(const P4_Cell *ip, const P4_Stack *rs);
+
+/**
+ * Write the live allocations grouped by allocating word, largest first.
+ */
+extern void p4HeapReport(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Write a summary of the memory used by data space, word headers,
+ * stacks, input, block buffer, and the dynamic memory heap.
+ */
+extern void p4MemReport(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * @return
+ *	Nanoseconds from a monotonic clock, if available; otherwise
+ *	process CPU time.
+ */
+extern uint64_t p4ClockNs(void);
+
+/**
+ * Start or resume counting calls and timing colon definitions.
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 if out of memory.
+ */
+extern int p4ProfileStart(P4_Ctx *ctx);
+
+/**
+ * Stop profiling, keeping the counts for p4ProfileReport().
+ */
+extern void p4ProfileStop(P4_Ctx *ctx);
+
+/**
+ * @return
+ *	True if profiling or sampling is on.
+ */
+extern int p4Profiling(P4_Ctx *ctx);
+
+/**
+ * Discard the counts and times so far.
+ */
+extern void p4ProfileReset(P4_Ctx *ctx);
+
+/**
+ * Release the profile counts; called by p4Free().
+ */
+extern void p4ProfileFree(P4_Ctx *ctx);
+
+/**
+ * Record a call of xt; see _enter_prof and _do_does_prof.
+ *
+ * @param ip
+ *	Where xt's definition starts executing.
+ */
+extern void p4ProfileEnter(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip);
+
+/**
+ * Record the return of the word at the current return stack depth;
+ * see _exit_prof.
+ */
+extern void p4ProfileExit(P4_Ctx *ctx);
+
+/**
+ * Replace the code field of every word equal to from[i] with to[i].
+ */
+extern void p4ProfileSwap(P4_Ctx *ctx, void *const *from, void *const *to, int n);
+
+/**
+ * Write the call counts, inclusive and exclusive times in nanoseconds,
+ * and averages per call, largest exclusive time first.
+ */
+extern void p4ProfileReport(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Start sampling the return stack on SIGPROF.  Only one context per
+ * process can be sampled at a time.
+ *
+ * @param usec
+ *	Interval of process CPU time in microseconds; zero (0) for the
+ *	default.
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 if out of memory, another
+ *	context is being sampled, or no interval timer.
+ */
+extern int p4SampleStart(P4_Ctx *ctx, P4_Uint usec);
+
+/**
+ * Stop sampling, keeping the samples for p4SampleReport().
+ */
+extern void p4SampleStop(P4_Ctx *ctx);
+
+/**
+ * Discard the samples so far.
+ */
+extern void p4SampleReset(P4_Ctx *ctx);
+
+/**
+ * Write a flat profile of the samples in each word, self and total,
+ * largest self first.
+ */
+extern void p4SampleReport(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Write one line per distinct stack, "outer;...;inner count", as
+ * used by flame graph tools.
+ */
+extern void p4SampleFolded(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Set while the return stack might be moved; the sampler skips.
+ */
+extern volatile sig_atomic_t p4_sample_hold;
+
+/**
+ * Start writing a binary record per word executed into a ring in
+ * memory, replacing any previous ring; turns on TRACE.
+ *
+ * @param n
+ *	Number of records, rounded up to a power of 2; zero (0) for
+ *	the default.
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 if out of memory.
+ */
+extern int p4TraceStart(P4_Ctx *ctx, P4_Uint n);
+
+/**
+ * Like p4TraceStart(), but the ring is a memory mapped file that
+ * survives the process and can be read by p4TraceDecode().
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 and errno set.
+ */
+extern int p4TraceStartFile(P4_Ctx *ctx, const char *path, P4_Uint n);
+
+/**
+ * Stop binary tracing, keeping the ring for p4TraceDump(); turns off
+ * TRACE.
+ */
+extern void p4TraceStop(P4_Ctx *ctx);
+
+/**
+ * @return
+ *	True if binary tracing is on.
+ */
+extern int p4TraceBinary(P4_Ctx *ctx);
+
+/**
+ * Record the execution of xt; see p4Trace().
+ *
+ * @return
+ *	True if binary tracing is on, the record written or filtered out.
+ */
+extern int p4TraceRecord(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip);
+
+/**
+ * Log the entry to and exit from words with P4_BIT_TRACE, once any
+ * are set; see p4Trace().
+ */
+extern void p4TraceWord(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip);
+
+/**
+ * Set ctx->trace to P4_TRACE_HOOKS while words are traced or coverage
+ * is on and nothing else is traced, otherwise clear it, so that _next
+ * tests a single field.
+ */
+extern void p4TraceHooks(P4_Ctx *ctx);
+
+/**
+ * Write the records in the ring, oldest first, in the format of -T.
+ */
+extern void p4TraceDump(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Write the records of a trace file, see p4TraceStartFile(), in the
+ * format of -T.
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 and errno set.
+ */
+extern int p4TraceDecode(const char *path, FILE *fp);
+
+/**
+ * Release the ring and filter; called by p4Free().
+ */
+extern void p4TraceFree(P4_Ctx *ctx);
+
+/**
+ * Start or resume marking the cells of threaded code executed.
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 if out of memory.
+ */
+extern int p4CoverStart(P4_Ctx *ctx);
+
+/**
+ * Stop marking, keeping the marks for p4CoverReport().
+ */
+extern void p4CoverStop(P4_Ctx *ctx);
+
+/**
+ * @return
+ *	True if marking is on.
+ */
+extern int p4Covering(P4_Ctx *ctx);
+
+/**
+ * Release the marks; called by p4Free().
+ */
+extern void p4CoverFree(P4_Ctx *ctx);
+
+/**
+ * Mark the cells of xt and its literals as executed, see _next.
+ *
+ * @param ip
+ *	Just after the cell of xt.
+ *
+ * @param top
+ *	Top of the data stack, the flag of a conditional branch.
+ */
+extern void p4CoverMark(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip, P4_Cell top);
+
+/**
+ * Note the source file and line of data space allotted; see p4Allot().
+ */
+extern void p4CoverAllot(P4_Ctx *ctx, void *start, P4_Int n);
+
+/**
+ * Write for each colon definition the fraction of cells executed and
+ * branch directions taken.
+ */
+extern void p4CoverReport(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Write an lcov tracefile for the words defined from files.
+ *
+ * @return
+ *	Zero (0) on success, otherwise -1 if out of memory.
+ */
+extern int p4CoverLcov(P4_Ctx *ctx, FILE *fp);
+
+#ifdef HAVE_STATS
+/**
+ * Write the interpreter counters, followed by the most executed words.
+ */
+extern void p4StatsReport(P4_Ctx *ctx, FILE *fp);
+
+/**
+ * Zero the interpreter counters and word execution counts.
+ */
+extern void p4StatsReset(P4_Ctx *ctx);
+
+/**
+ * Charge the time since the previous phase change to that phase and
+ * source file, then start timing the given phase of the current input.
+ */
+extern void p4StatsPhase(P4_Ctx *ctx, P4_Phase phase);
+
+/**
+ * Release the per source file phase table.
+ */
+extern void p4StatsFree(P4_Ctx *ctx);
+#endif
+
 
 /**
  * @param ch
@@ -711,8 +1154,80 @@ extern int p4CharLiteral(int ch);
  */
 extern void p4StrRev(P4_Char *s, P4_Size length);
 
+/**
+ * @param x
+ *	An unsigned cell.
+ *
+ * @return
+ *	The number of leading zero bits in x; P4_UINT_BITS when x is zero.
+ */
+extern unsigned p4LeadZeroBits(P4_Uint x);
+
 extern int p4StrNum(P4_String str, unsigned base, P4_Cell out[2], int *is_float, int *is_double);
 
+#ifdef HAVE_MATH_H
+# define P4_FLOAT_DIGITS	20	/* Shortest digits of a double, at most 17. */
+# define P4_FLOAT_MAXDIG	40	/* Most significant digits formatted. */
+# define P4_FLOAT_BUFFER	400	/* Fits DBL_MAX in fixed notation. */
+# define P4_FLOAT_STRING	32	/* Fits the round-trip string of a double. */
+
+/**
+ * @param v
+ *	A finite positive double.
+ *
+ * @param digits
+ *	Output buffer for decimal digits, usually the shortest, that read
+ *	back as v; not NUL terminated.
+ *
+ * @param exp10
+ *	Output decimal exponent of the first digit, ie. v = d.ddd * 10^exp10.
+ *
+ * @return
+ *	The number of digits.
+ */
+extern int p4FloatShortest(double v, char digits[P4_FLOAT_DIGITS], int *exp10);
+
+/**
+ * @param v
+ *	A finite, non-negative double.
+ *
+ * @param p
+ *	The number of significant digits, 1 to P4_FLOAT_MAXDIG.
+ *
+ * @param out
+ *	Output buffer for the p digits of v correctly rounded, as by
+ *	printf("%.*E", p-1, v); not NUL terminated.
+ *
+ * @param exp10
+ *	Output decimal exponent of the first digit.
+ */
+extern void p4FloatDigits(double v, int p, char *out, int *exp10);
+
+/**
+ * @param buf
+ *	Output buffer of P4_FLOAT_BUFFER bytes.
+ *
+ * @param style
+ *	'F' as printf("%.*F"), 'E' as printf("%.*E"), or 'e' engineering
+ *	notation with prec significant digits.
+ *
+ * @return
+ *	The length of the string, which is truncated when not less than
+ *	P4_FLOAT_BUFFER, like snprintf.
+ */
+extern int p4FloatFormat(char *buf, P4_Float f, int prec, int style);
+
+/**
+ * @param buf
+ *	Output buffer of P4_FLOAT_STRING bytes for a string, usually the
+ *	shortest, eg. "1.5E-7", that reads back as f.
+ *
+ * @return
+ *	The length of the string.
+ */
+extern size_t p4FloatString(char *buf, P4_Float f);
+#endif
+
 extern int p4Accept(P4_Input *source, char *buffer, size_t size);
 
 /**
@@ -0,0 +1,264 @@
+/*
+ * pqueue.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+/*
+ * A 4-ary heap; the children of a node share one or two cache lines and
+ * the tree is half the depth of a binary heap, trading a few more
+ * comparisons on pop for fewer cache misses.
+ */
+#ifndef P4_PQ_ARITY
+#define P4_PQ_ARITY		4
+#endif
+
+typedef struct {
+	P4_Cell		priority;
+	P4_Cell		x;
+} P4_Pq_Entry;
+
+/*
+ * A queue is allocated by ALLOCATE, so FREE releases it.
+ */
+typedef struct {
+	P4_Size		length;
+	P4_Size		capacity;
+	P4_Xt		xt;		/* NULL for ascending signed priorities */
+	P4_Pq_Entry	heap[];
+} P4_Pqueue;
+
+/*
+ * Bound on the swaps of one sift, the height of the heap.
+ */
+#define P4_PQ_DEPTH		(sizeof (P4_Size) * CHAR_BIT)
+
+/*
+ * Compare priorities; the Forth comparator is ( p1 p2 -- n ) where n
+ * is less than zero when p1 pops first.  An exception from the
+ * comparator is returned in rc, with false.
+ */
+static int
+p4PqLess(P4_Ctx *ctx, P4_Pqueue *pq, P4_Size i, P4_Size j, int *rc)
+{
+	if (pq->xt == NULL) {
+		return pq->heap[i].priority.n < pq->heap[j].priority.n;
+	}
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, pq->heap[i].priority);
+	P4_PUSH(ctx->ds, pq->heap[j].priority);
+	if ((*rc = p4Call(ctx, pq->xt)) != P4_THROW_OK) {
+		return 0;
+	}
+	if (P4_LENGTH(ctx->ds) < 1) {
+		*rc = P4_THROW_DS_UNDER;
+		return 0;
+	}
+	return P4_POP(ctx->ds).n < 0;
+}
+
+static void
+p4PqSwap(P4_Pqueue *pq, P4_Size i, P4_Size j)
+{
+	P4_Pq_Entry t = pq->heap[i];
+	pq->heap[i] = pq->heap[j];
+	pq->heap[j] = t;
+}
+
+/*
+ * Each swap of a sift is between a child in path[] and its parent;
+ * undo them newest first to restore the heap as it was.
+ */
+static void
+p4PqUndo(P4_Pqueue *pq, const P4_Size *path, P4_Size n)
+{
+	while (0 < n--) {
+		p4PqSwap(pq, path[n], (path[n] - 1) / P4_PQ_ARITY);
+	}
+}
+
+/*
+ * Return P4_THROW_OK, otherwise the comparator's exception with the
+ * heap unchanged.
+ */
+static int
+p4PqSiftUp(P4_Ctx *ctx, P4_Pqueue *pq, P4_Size i)
+{
+	int rc = P4_THROW_OK;
+	P4_Size parent, path[P4_PQ_DEPTH], n = 0;
+
+	for ( ; 0 < i; i = parent) {
+		parent = (i - 1) / P4_PQ_ARITY;
+		if (!p4PqLess(ctx, pq, i, parent, &rc)) {
+			break;
+		}
+		p4PqSwap(pq, i, parent);
+		path[n++] = i;
+	}
+	if (rc != P4_THROW_OK) {
+		p4PqUndo(pq, path, n);
+	}
+	return rc;
+}
+
+static int
+p4PqSiftDown(P4_Ctx *ctx, P4_Pqueue *pq, P4_Size i)
+{
+	int rc = P4_THROW_OK;
+	P4_Size child, best, last, path[P4_PQ_DEPTH], n = 0;
+
+	for ( ; (child = i * P4_PQ_ARITY + 1) < pq->length; i = best) {
+		last = child + P4_PQ_ARITY;
+		if (pq->length < last) {
+			last = pq->length;
+		}
+		for (best = child++; child < last && rc == P4_THROW_OK; child++) {
+			if (p4PqLess(ctx, pq, child, best, &rc)) {
+				best = child;
+			}
+		}
+		if (rc != P4_THROW_OK || !p4PqLess(ctx, pq, best, i, &rc)) {
+			break;
+		}
+		p4PqSwap(pq, i, best);
+		path[n++] = best;
+	}
+	if (rc != P4_THROW_OK) {
+		p4PqUndo(pq, path, n);
+	}
+	return rc;
+}
+
+static P4_Pqueue *
+p4PqPop(P4_Ctx *ctx)
+{
+	P4_Pqueue *pq = P4_POP(ctx->ds).v;
+	if (pq == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_SIGSEGV);
+	}
+	return pq;
+}
+
+static void
+p4PqNew(P4_Ctx *ctx, P4_Size capacity, P4_Xt xt)
+{
+	P4_Pqueue *pq;
+	/* The size in bytes would wrap. */
+	if ((SIZE_MAX - sizeof (*pq)) / sizeof (*pq->heap) < capacity) {
+		LONGJMP(ctx->longjmp, P4_THROW_BAD_NUMBER);
+	}
+	if ((pq = p4HeapRealloc(NULL, sizeof (*pq) + capacity * sizeof (*pq->heap))) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	pq->length = 0;
+	pq->capacity = capacity;
+	pq->xt = xt;
+	P4_PUSH(ctx->ds, (void *) pq);
+}
+
+/*
+ * pq-new ( u -- pq )
+ */
+static void
+p4PqNewHook(P4_Ctx *ctx)
+{
+	P4_Size capacity = P4_POP(ctx->ds).z;
+	p4PqNew(ctx, capacity, NULL);
+}
+
+/*
+ * pq-new-by ( u xt -- pq )
+ */
+static void
+p4PqNewBy(P4_Ctx *ctx)
+{
+	P4_Xt xt = P4_POP(ctx->ds).xt;
+	P4_Size capacity = P4_POP(ctx->ds).z;
+	p4PqNew(ctx, capacity, xt);
+}
+
+/*
+ * pq-push ( x priority pq -- )
+ */
+static void
+p4PqPush(P4_Ctx *ctx)
+{
+	int rc;
+	P4_Pqueue *pq = p4PqPop(ctx);
+	if (pq->capacity <= pq->length) {
+		LONGJMP(ctx->longjmp, P4_THROW_ERANGE);
+	}
+	pq->heap[pq->length].priority = P4_POP(ctx->ds);
+	pq->heap[pq->length].x = P4_POP(ctx->ds);
+	if ((rc = p4PqSiftUp(ctx, pq, pq->length++)) != P4_THROW_OK) {
+		/* The queue is unchanged. */
+		pq->length--;
+		LONGJMP(ctx->longjmp, rc);
+	}
+}
+
+/*
+ * pq-pop ( pq -- x priority )
+ */
+static void
+p4PqPopHook(P4_Ctx *ctx)
+{
+	int rc;
+	P4_Pq_Entry top;
+	P4_Pqueue *pq = p4PqPop(ctx);
+	if (pq->length == 0) {
+		LONGJMP(ctx->longjmp, P4_THROW_ERANGE);
+	}
+	top = pq->heap[0];
+	pq->heap[0] = pq->heap[--pq->length];
+	if ((rc = p4PqSiftDown(ctx, pq, 0)) != P4_THROW_OK) {
+		/* Put back the last and the root; the queue is unchanged. */
+		pq->heap[pq->length++] = pq->heap[0];
+		pq->heap[0] = top;
+		LONGJMP(ctx->longjmp, rc);
+	}
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, top.x);
+	P4_PUSH(ctx->ds, top.priority);
+}
+
+/*
+ * pq-peek ( pq -- x priority )
+ */
+static void
+p4PqPeek(P4_Ctx *ctx)
+{
+	P4_Pqueue *pq = p4PqPop(ctx);
+	if (pq->length == 0) {
+		LONGJMP(ctx->longjmp, P4_THROW_ERANGE);
+	}
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, pq->heap[0].x);
+	P4_PUSH(ctx->ds, pq->heap[0].priority);
+}
+
+/*
+ * pq-len ( pq -- u )
+ */
+static void
+p4PqLen(P4_Ctx *ctx)
+{
+	P4_Pqueue *pq = p4PqPop(ctx);
+	P4_PUSH(ctx->ds, pq->length);
+}
+
+P4_Hook p4_pqueue_hooks[] = {
+	P4_HOOK(0x11, "pq-new", p4PqNewHook),
+	P4_HOOK(0x21, "pq-new-by", p4PqNewBy),
+	P4_HOOK(0x30, "pq-push", p4PqPush),
+	P4_HOOK(0x12, "pq-pop", p4PqPopHook),
+	P4_HOOK(0x12, "pq-peek", p4PqPeek),
+	P4_HOOK(0x11, "pq-len", p4PqLen),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
@@ -0,0 +1,754 @@
+/*
+ * profile.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#include <stdatomic.h>
+#ifdef HAVE_SYS_TIME_H
+# include <sys/time.h>
+#endif
+
+/*
+ * Call counts and times of colon definitions.  While profiling, the
+ * code field of each colon definition (and DOES> word) points to code
+ * that records the entry before entering as usual, and EXIT records
+ * the exit; otherwise the inner interpreter is untouched.
+ *
+ * Each call pushes a frame noting the return stack depth.  An exit
+ * closes the frame at the current depth; frames above it, abandoned
+ * by THROW or return stack juggling, are closed first.
+ */
+typedef struct {
+	const P4_Word *	xt;
+	uint64_t	calls;
+	uint64_t	incl;		/* nanoseconds */
+	uint64_t	excl;		/* nanoseconds */
+	P4_Uint		active;		/* Recursion depth. */
+} P4_Prof_Word;
+
+typedef struct {
+	size_t		word;		/* Index into words. */
+	ptrdiff_t	depth;		/* Return stack depth. */
+	uint64_t	start;
+	uint64_t	child;		/* Inclusive time of callees. */
+} P4_Prof_Frame;
+
+/*
+ * SIGPROF samples the position in the current colon definition, as of
+ * its last call or return, and the return addresses on the return
+ * stack into a ring buffer.  The buffer is drained into counts of each
+ * distinct stack when calling or returning; the addresses are resolved
+ * to words only for a report, so the handler does no allocation.
+ */
+#ifndef P4_SAMPLE_DEPTH
+#define P4_SAMPLE_DEPTH		32		/* frames per sample */
+#endif
+#ifndef P4_SAMPLE_RING
+#define P4_SAMPLE_RING		1024		/* samples, power of 2 */
+#endif
+
+typedef struct {
+	size_t		depth;
+	const P4_Cell *	ip[P4_SAMPLE_DEPTH];	/* Innermost first. */
+} P4_Sample;
+
+typedef struct {
+	uint64_t	hash;
+	size_t		at;		/* Index into ips. */
+	size_t		depth;
+	P4_Uint		count;
+} P4_Sample_Stack;
+
+typedef struct {
+	int		on;
+	const P4_Cell * volatile ip;	/* Current colon definition. */
+	atomic_size_t	head;		/* Written by the signal handler. */
+	atomic_size_t	tail;
+	P4_Uint		total;
+	atomic_size_t	lost;		/* Ring full or out of memory. */
+	size_t		nstacks;
+	size_t		maxstacks;
+	P4_Sample_Stack *stacks;
+	size_t		hsize;		/* Power of 2. */
+	size_t *	hash;		/* Index + 1 into stacks; 0 empty. */
+	size_t		nips;
+	size_t		maxips;
+	const P4_Cell **ips;
+	P4_Sample	ring[P4_SAMPLE_RING];
+} P4_Sampler;
+
+typedef struct {
+	int		on;
+	P4_Sampler *	sampler;
+	size_t		nwords;
+	size_t		maxwords;
+	P4_Prof_Word *	words;
+	size_t		hsize;		/* Power of 2. */
+	size_t *	hash;		/* Index + 1 into words; 0 empty. */
+	size_t		nframes;
+	size_t		maxframes;
+	P4_Prof_Frame *	frames;
+} P4_Profile;
+
+#ifndef P4_PROFILE_HASH
+#define P4_PROFILE_HASH		256		/* initial slots */
+#endif
+
+static size_t
+p4ProfileSlot(const P4_Profile *prof, const P4_Word *xt)
+{
+	return (size_t) (((P4_Uint) xt >> 4) * 0x9E3779B97F4A7C15ULL) & (prof->hsize - 1);
+}
+
+static int
+p4ProfileRehash(P4_Profile *prof, size_t hsize)
+{
+	size_t i, j, *hash;
+	if ((hash = calloc(hsize, sizeof (*hash))) == NULL) {
+		return -1;
+	}
+	free(prof->hash);
+	prof->hash = hash;
+	prof->hsize = hsize;
+	for (i = 0; i < prof->nwords; i++) {
+		for (j = p4ProfileSlot(prof, prof->words[i].xt); hash[j] != 0; j = (j + 1) & (hsize - 1)) {
+			;
+		}
+		hash[j] = i + 1;
+	}
+	return 0;
+}
+
+/* Return the index of the word's counts, adding them as needed; -1 on error. */
+static ptrdiff_t
+p4ProfileWord(P4_Profile *prof, const P4_Word *xt)
+{
+	size_t i, n;
+	P4_Prof_Word *words;
+
+	for (i = p4ProfileSlot(prof, xt); prof->hash[i] != 0; i = (i + 1) & (prof->hsize - 1)) {
+		if (prof->words[prof->hash[i] - 1].xt == xt) {
+			return prof->hash[i] - 1;
+		}
+	}
+	if (prof->maxwords <= prof->nwords) {
+		n = prof->maxwords * 2;
+		if ((words = realloc(prof->words, n * sizeof (*words))) == NULL) {
+			return -1;
+		}
+		prof->words = words;
+		prof->maxwords = n;
+	}
+	n = prof->nwords;
+	(void) memset(&prof->words[n], 0, sizeof (*prof->words));
+	prof->words[n].xt = xt;
+	prof->hash[i] = ++prof->nwords;
+	/* Keep the table at most half full. */
+	if (prof->hsize < 2 * prof->nwords && p4ProfileRehash(prof, 2 * prof->hsize)) {
+		prof->hash[i] = 0;
+		prof->nwords--;
+		return -1;
+	}
+	return n;
+}
+
+static void
+p4ProfileClose(P4_Profile *prof, uint64_t now)
+{
+	P4_Prof_Frame *frame = &prof->frames[--prof->nframes];
+	P4_Prof_Word *word = &prof->words[frame->word];
+	uint64_t incl = now - frame->start;
+
+	word->excl += incl - frame->child;
+	/* Count only the outermost call of a recursive word. */
+	if (--word->active == 0) {
+		word->incl += incl;
+	}
+	if (0 < prof->nframes) {
+		prof->frames[prof->nframes - 1].child += incl;
+	}
+}
+
+/* Close the frames at or above the depth. */
+static void
+p4ProfileUnwind(P4_Profile *prof, ptrdiff_t depth, uint64_t now)
+{
+	while (0 < prof->nframes && depth <= prof->frames[prof->nframes - 1].depth) {
+		p4ProfileClose(prof, now);
+	}
+}
+
+static void p4SampleDrain(P4_Sampler *s);
+static void p4SampleFree(P4_Sampler *s);
+
+static void
+p4SampleAt(P4_Sampler *s, const P4_Cell *ip)
+{
+	s->ip = ip;
+	if (P4_SAMPLE_RING / 2 <= atomic_load(&s->head) - atomic_load(&s->tail)) {
+		p4SampleDrain(s);
+	}
+}
+
+void
+p4ProfileEnter(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip)
+{
+	ptrdiff_t i, depth;
+	P4_Prof_Frame *frames;
+	P4_Profile *prof = ctx->profile;
+
+	if (prof == NULL) {
+		return;
+	}
+	if (prof->sampler != NULL && prof->sampler->on) {
+		p4SampleAt(prof->sampler, ip);
+	}
+	if (!prof->on) {
+		return;
+	}
+	/* Depth once the caller's ip is pushed. */
+	depth = P4_LENGTH(ctx->rs) + 1;
+	p4ProfileUnwind(prof, depth, p4ClockNs());
+	if (prof->maxframes <= prof->nframes) {
+		if ((frames = realloc(prof->frames, 2 * prof->maxframes * sizeof (*frames))) == NULL) {
+			return;
+		}
+		prof->frames = frames;
+		prof->maxframes *= 2;
+	}
+	if ((i = p4ProfileWord(prof, xt)) < 0) {
+		return;
+	}
+	prof->words[i].calls++;
+	prof->words[i].active++;
+	prof->frames[prof->nframes].word = i;
+	prof->frames[prof->nframes].depth = depth;
+	prof->frames[prof->nframes].child = 0;
+	/* Exclude the book keeping above. */
+	prof->frames[prof->nframes++].start = p4ClockNs();
+}
+
+void
+p4ProfileExit(P4_Ctx *ctx)
+{
+	uint64_t now;
+	ptrdiff_t depth;
+	P4_Profile *prof = ctx->profile;
+
+	if (prof == NULL) {
+		return;
+	}
+	if (prof->sampler != NULL && prof->sampler->on && 0 < P4_LENGTH(ctx->rs)) {
+		/* Returning to the caller. */
+		p4SampleAt(prof->sampler, P4_TOP(ctx->rs).p);
+	}
+	if (!prof->on) {
+		return;
+	}
+	now = p4ClockNs();
+	depth = P4_LENGTH(ctx->rs);
+	p4ProfileUnwind(prof, depth + 1, now);
+	if (0 < prof->nframes && prof->frames[prof->nframes - 1].depth == depth) {
+		p4ProfileClose(prof, now);
+	}
+}
+
+/* Return the profile state, creating it as needed; NULL if out of memory. */
+static P4_Profile *
+p4ProfileGet(P4_Ctx *ctx)
+{
+	P4_Profile *prof = ctx->profile;
+
+	if (prof == NULL) {
+		if ((prof = calloc(1, sizeof (*prof))) == NULL) {
+			return NULL;
+		}
+		prof->maxwords = P4_PROFILE_HASH / 2;
+		prof->maxframes = 64;
+		if ((prof->words = malloc(prof->maxwords * sizeof (*prof->words))) == NULL
+		|| (prof->frames = malloc(prof->maxframes * sizeof (*prof->frames))) == NULL
+		|| p4ProfileRehash(prof, P4_PROFILE_HASH)) {
+			free(prof->words);
+			free(prof->frames);
+			free(prof);
+			return NULL;
+		}
+		ctx->profile = prof;
+	}
+	return prof;
+}
+
+int
+p4ProfileStart(P4_Ctx *ctx)
+{
+	P4_Profile *prof;
+
+	if ((prof = p4ProfileGet(ctx)) == NULL) {
+		return -1;
+	}
+	prof->nframes = 0;
+	prof->on = 1;
+	return 0;
+}
+
+void
+p4ProfileStop(P4_Ctx *ctx)
+{
+	P4_Profile *prof = ctx->profile;
+	if (prof != NULL) {
+		p4ProfileUnwind(prof, 0, p4ClockNs());
+		prof->on = 0;
+	}
+}
+
+int
+p4Profiling(P4_Ctx *ctx)
+{
+	P4_Profile *prof = ctx->profile;
+	return prof != NULL && (prof->on || (prof->sampler != NULL && prof->sampler->on));
+}
+
+void
+p4ProfileReset(P4_Ctx *ctx)
+{
+	P4_Profile *prof = ctx->profile;
+	if (prof != NULL) {
+		prof->nwords = 0;
+		prof->nframes = 0;
+		(void) memset(prof->hash, 0, prof->hsize * sizeof (*prof->hash));
+	}
+}
+
+void
+p4ProfileFree(P4_Ctx *ctx)
+{
+	P4_Profile *prof = ctx->profile;
+	if (prof != NULL) {
+		p4SampleStop(ctx);
+		p4SampleFree(prof->sampler);
+		free(prof->hash);
+		free(prof->frames);
+		free(prof->words);
+		free(prof);
+		ctx->profile = NULL;
+	}
+}
+
+void
+p4ProfileSwap(P4_Ctx *ctx, void *const *from, void *const *to, int n)
+{
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		for (P4_Word *word = ctx->lists[i]; word != NULL; word = word->prev) {
+			for (int j = 0; j < n; j++) {
+				if (word->code == from[j]) {
+					word->code = to[j];
+					break;
+				}
+			}
+		}
+	}
+}
+
+static int
+p4ProfileByExcl(const void *a, const void *b)
+{
+	const P4_Prof_Word *x = *(P4_Prof_Word **) a, *y = *(P4_Prof_Word **) b;
+	return (x->excl < y->excl) - (y->excl < x->excl);
+}
+
+void
+p4ProfileReport(P4_Ctx *ctx, FILE *fp)
+{
+	size_t i;
+	P4_Prof_Word *word, **order;
+	P4_Profile *prof = ctx->profile;
+
+	if (prof == NULL || prof->nwords == 0) {
+		return;
+	}
+	/* Sort a list of pointers; open frames index the words. */
+	if ((order = malloc(prof->nwords * sizeof (*order))) == NULL) {
+		return;
+	}
+	for (i = 0; i < prof->nwords; i++) {
+		order[i] = &prof->words[i];
+	}
+	qsort(order, prof->nwords, sizeof (*order), p4ProfileByExcl);
+	(void) fprintf(fp, "%10s %14s %14s %12s %12s  %s" NL,
+		"calls", "incl ns", "excl ns", "incl/call", "excl/call", "word"
+	);
+	for (i = 0; i < prof->nwords; i++) {
+		word = order[i];
+		(void) fprintf(fp, "%10" PRIu64 " %14" PRIu64 " %14" PRIu64 " %12" PRIu64 " %12" PRIu64 "  %.*s" NL,
+			word->calls, word->incl, word->excl,
+			word->incl / word->calls, word->excl / word->calls,
+			word->xt->length == 0 ? 7 : (int) word->xt->length,
+			word->xt->length == 0 ? ":NONAME" : word->xt->name
+		);
+	}
+	free(order);
+}
+
+/***********************************************************************
+ *** Sampling
+ ***********************************************************************/
+
+/* Set while a stack is reallocated, see p4AllocStack. */
+volatile sig_atomic_t p4_sample_hold;
+
+/* Only one interval timer per process. */
+static P4_Ctx *volatile p4_sample_ctx;
+#ifdef ITIMER_PROF
+static struct sigaction p4_sample_old;
+
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static void
+p4SampleSignal(int signum)
+{
+	const P4_Cell *rp;
+	P4_Sample *sample;
+	P4_Sampler *s;
+	size_t head, depth;
+	P4_Ctx *ctx = p4_sample_ctx;
+
+	if (ctx == NULL || p4_sample_hold) {
+		return;
+	}
+	s = ((P4_Profile *) ctx->profile)->sampler;
+	head = atomic_load(&s->head);
+	if (P4_SAMPLE_RING <= head - atomic_load(&s->tail)) {
+		atomic_fetch_add(&s->lost, 1);
+		return;
+	}
+	sample = &s->ring[head & (P4_SAMPLE_RING - 1)];
+	depth = 0;
+	sample->ip[depth++] = s->ip;
+	for (rp = ctx->rs.top; depth < P4_SAMPLE_DEPTH && ctx->rs.base <= rp; rp--) {
+		sample->ip[depth++] = rp->p;
+	}
+	sample->depth = depth;
+	atomic_store(&s->head, head + 1);
+}
+#pragma GCC diagnostic pop
+#endif /* ITIMER_PROF */
+
+static uint64_t
+p4SampleHash(const P4_Cell **ip, size_t depth)
+{
+	/* FNV-1a over the addresses. */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < depth; i++) {
+		hash = (hash ^ (P4_Uint) ip[i]) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static int
+p4SampleRehash(P4_Sampler *s, size_t hsize)
+{
+	size_t i, j, *hash;
+	if ((hash = calloc(hsize, sizeof (*hash))) == NULL) {
+		return -1;
+	}
+	free(s->hash);
+	s->hash = hash;
+	s->hsize = hsize;
+	for (i = 0; i < s->nstacks; i++) {
+		for (j = s->stacks[i].hash & (hsize - 1); hash[j] != 0; j = (j + 1) & (hsize - 1)) {
+			;
+		}
+		hash[j] = i + 1;
+	}
+	return 0;
+}
+
+/* Count one sample against its distinct stack; -1 if out of memory. */
+static int
+p4SampleCount(P4_Sampler *s, const P4_Sample *sample)
+{
+	void *mem;
+	size_t i, n;
+	P4_Sample_Stack *stack;
+	uint64_t hash = p4SampleHash((const P4_Cell **) sample->ip, sample->depth);
+
+	if (s->hsize < 2 * (s->nstacks + 1) && p4SampleRehash(s, s->hsize < 64 ? 64 : 2 * s->hsize)) {
+		return -1;
+	}
+	for (i = hash & (s->hsize - 1); s->hash[i] != 0; i = (i + 1) & (s->hsize - 1)) {
+		stack = &s->stacks[s->hash[i] - 1];
+		if (stack->hash == hash && stack->depth == sample->depth
+		&& memcmp(&s->ips[stack->at], sample->ip, sample->depth * sizeof (*sample->ip)) == 0) {
+			stack->count++;
+			return 0;
+		}
+	}
+	if (s->maxstacks <= s->nstacks) {
+		n = s->maxstacks < 32 ? 32 : 2 * s->maxstacks;
+		if ((mem = realloc(s->stacks, n * sizeof (*s->stacks))) == NULL) {
+			return -1;
+		}
+		s->stacks = mem;
+		s->maxstacks = n;
+	}
+	if (s->maxips < s->nips + sample->depth) {
+		n = s->maxips < 1024 ? 1024 : 2 * s->maxips;
+		if ((mem = realloc(s->ips, n * sizeof (*s->ips))) == NULL) {
+			return -1;
+		}
+		s->ips = mem;
+		s->maxips = n;
+	}
+	stack = &s->stacks[s->nstacks];
+	stack->hash = hash;
+	stack->at = s->nips;
+	stack->depth = sample->depth;
+	stack->count = 1;
+	(void) memcpy(&s->ips[s->nips], sample->ip, sample->depth * sizeof (*sample->ip));
+	s->nips += sample->depth;
+	s->hash[i] = ++s->nstacks;
+	return 0;
+}
+
+static void
+p4SampleDrain(P4_Sampler *s)
+{
+	size_t tail = atomic_load(&s->tail);
+	size_t head = atomic_load(&s->head);
+
+	for ( ; tail != head; tail++) {
+		if (p4SampleCount(s, &s->ring[tail & (P4_SAMPLE_RING - 1)])) {
+			atomic_fetch_add(&s->lost, 1);
+		} else {
+			s->total++;
+		}
+	}
+	atomic_store(&s->tail, tail);
+}
+
+static void
+p4SampleFree(P4_Sampler *s)
+{
+	if (s != NULL) {
+		free(s->stacks);
+		free(s->hash);
+		free(s->ips);
+		free(s);
+	}
+}
+
+int
+p4SampleStart(P4_Ctx *ctx, P4_Uint usec)
+{
+#ifdef ITIMER_PROF
+	P4_Profile *prof;
+	struct sigaction sa;
+	struct itimerval it;
+
+	if (p4_sample_ctx != NULL) {
+		/* Already sampling, possibly another context. */
+		return p4_sample_ctx == ctx ? 0 : -1;
+	}
+	if ((prof = p4ProfileGet(ctx)) == NULL) {
+		return -1;
+	}
+	if (prof->sampler == NULL && (prof->sampler = calloc(1, sizeof (*prof->sampler))) == NULL) {
+		return -1;
+	}
+	prof->sampler->on = 1;
+	p4_sample_ctx = ctx;
+
+	(void) memset(&sa, 0, sizeof (sa));
+	sa.sa_handler = p4SampleSignal;
+	sa.sa_flags = SA_RESTART;
+	(void) sigemptyset(&sa.sa_mask);
+	(void) sigaction(SIGPROF, &sa, &p4_sample_old);
+
+	if (usec == 0) {
+		usec = P4_SAMPLE_USEC;
+	}
+	it.it_interval.tv_sec = usec / 1000000;
+	it.it_interval.tv_usec = usec % 1000000;
+	it.it_value = it.it_interval;
+	if (setitimer(ITIMER_PROF, &it, NULL)) {
+		p4SampleStop(ctx);
+		return -1;
+	}
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+void
+p4SampleStop(P4_Ctx *ctx)
+{
+#ifdef ITIMER_PROF
+	struct itimerval it;
+	P4_Profile *prof = ctx->profile;
+
+	if (p4_sample_ctx != ctx) {
+		return;
+	}
+	(void) memset(&it, 0, sizeof (it));
+	(void) setitimer(ITIMER_PROF, &it, NULL);
+	(void) sigaction(SIGPROF, &p4_sample_old, NULL);
+	p4_sample_ctx = NULL;
+	prof->sampler->on = 0;
+	p4SampleDrain(prof->sampler);
+#endif
+}
+
+void
+p4SampleReset(P4_Ctx *ctx)
+{
+	P4_Profile *prof = ctx->profile;
+	P4_Sampler *s;
+
+	if (prof != NULL && (s = prof->sampler) != NULL) {
+		p4SampleDrain(s);
+		s->nstacks = 0;
+		s->nips = 0;
+		s->total = 0;
+		atomic_store(&s->lost, 0);
+		if (s->hash != NULL) {
+			(void) memset(s->hash, 0, s->hsize * sizeof (*s->hash));
+		}
+	}
+}
+
+/*
+ * Find the definition whose body holds ip.  Constants keep their value
+ * in ndata with no data.  The return stack also holds loop parameters
+ * and >R values; those rarely resolve and are skipped.
+ */
+static const P4_Word *
+p4SampleWord(P4_Ctx *ctx, const P4_Cell *ip, P4_Uint *offset)
+{
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		for (P4_Word *word = ctx->lists[i]; word != NULL; word = word->prev) {
+			if (word->data != NULL && word->data <= ip
+			&& (const char *) ip < (const char *) word->data + word->ndata) {
+				*offset = ip - word->data;
+				return word;
+			}
+		}
+	}
+	return NULL;
+}
+
+static int
+p4SampleBySelf(const void *a, const void *b)
+{
+	const P4_Prof_Word *x = a, *y = b;
+	return (x->excl < y->excl) - (y->excl < x->excl);
+}
+
+static void
+p4SampleName(FILE *fp, const P4_Word *word)
+{
+	if (word->length == 0) {
+		(void) fputs(":NONAME", fp);
+		return;
+	}
+	/* Semicolon separates frames in folded stacks. */
+	for (size_t i = 0; i < word->length; i++) {
+		(void) fputc(word->name[i] == ';' ? '_' : word->name[i], fp);
+	}
+}
+
+void
+p4SampleReport(P4_Ctx *ctx, FILE *fp)
+{
+	size_t i, j;
+	ptrdiff_t k;
+	P4_Uint offset;
+	const P4_Word *word;
+	P4_Sample_Stack *stack;
+	P4_Profile *prof = ctx->profile, tally;
+
+	if (prof == NULL || prof->sampler == NULL) {
+		return;
+	}
+	p4SampleDrain(prof->sampler);
+
+	/*
+	 * Reuse the call table to tally words: calls counts the samples
+	 * with the word anywhere on the stack, excl those in the word.
+	 */
+	(void) memset(&tally, 0, sizeof (tally));
+	tally.maxwords = P4_PROFILE_HASH / 2;
+	if ((tally.words = malloc(tally.maxwords * sizeof (*tally.words))) == NULL
+	|| p4ProfileRehash(&tally, P4_PROFILE_HASH)) {
+		free(tally.words);
+		return;
+	}
+	for (i = 0; i < prof->sampler->nstacks; i++) {
+		stack = &prof->sampler->stacks[i];
+		for (j = 0; j < stack->depth; j++) {
+			if ((word = p4SampleWord(ctx, prof->sampler->ips[stack->at + j], &offset)) == NULL
+			|| (k = p4ProfileWord(&tally, word)) < 0) {
+				continue;
+			}
+			if (j == 0) {
+				tally.words[k].excl += stack->count;
+			}
+			/* Count recursive words once per stack. */
+			if (tally.words[k].active != i + 1) {
+				tally.words[k].active = i + 1;
+				tally.words[k].calls += stack->count;
+			}
+		}
+	}
+	qsort(tally.words, tally.nwords, sizeof (*tally.words), p4SampleBySelf);
+	(void) fprintf(fp, "%lu samples, %lu lost" NL "%10s %7s %10s %7s  %s" NL,
+		(unsigned long) prof->sampler->total, (unsigned long) atomic_load(&prof->sampler->lost),
+		"self", "self%", "total", "total%", "word"
+	);
+	for (i = 0; i < tally.nwords; i++) {
+		(void) fprintf(fp, "%10lu %6.2f%% %10lu %6.2f%%  ",
+			(unsigned long) tally.words[i].excl, 100.0 * tally.words[i].excl / prof->sampler->total,
+			(unsigned long) tally.words[i].calls, 100.0 * tally.words[i].calls / prof->sampler->total
+		);
+		p4SampleName(fp, tally.words[i].xt);
+		(void) fputs(NL, fp);
+	}
+	free(tally.words);
+	free(tally.hash);
+}
+
+void
+p4SampleFolded(P4_Ctx *ctx, FILE *fp)
+{
+	int sep;
+	size_t i, j;
+	P4_Uint offset;
+	const P4_Word *word;
+	P4_Sample_Stack *stack;
+	P4_Profile *prof = ctx->profile;
+
+	if (prof == NULL || prof->sampler == NULL) {
+		return;
+	}
+	p4SampleDrain(prof->sampler);
+	for (i = 0; i < prof->sampler->nstacks; i++) {
+		stack = &prof->sampler->stacks[i];
+		/* Outermost caller first. */
+		for (sep = 0, j = stack->depth; 0 < j--; ) {
+			if ((word = p4SampleWord(ctx, prof->sampler->ips[stack->at + j], &offset)) != NULL) {
+				if (sep) {
+					(void) fputc(';', fp);
+				}
+				p4SampleName(fp, word);
+				sep = 1;
+			}
+		}
+		if (sep) {
+			(void) fprintf(fp, " %u" NL, (unsigned) stack->count);
+		}
+	}
+}
@@ -0,0 +1,225 @@
+/*
+ * random.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+#ifndef P4_RANDOM_SEED
+#define P4_RANDOM_SEED		0x853c49e6748fea9bULL
+#endif
+
+/*
+ * xoshiro256** by David Blackman and Sebastiano Vigna, see
+ * https://prng.di.unimi.it/  The state is seeded from splitmix64 so
+ * that any seed, including zero, gives a valid non-zero state.
+ */
+static inline uint64_t
+p4Rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t
+p4SplitMix(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static void
+p4RandomSeed(uint64_t *s, uint64_t seed)
+{
+	for (int i = 0; i < 4; i++) {
+		s[i] = p4SplitMix(&seed);
+	}
+}
+
+static inline uint64_t
+p4RandomNext(uint64_t *s)
+{
+	uint64_t result = p4Rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = p4Rotl(s[3], 45);
+	return result;
+}
+
+/*
+ * Equivalent to 2^128 calls of p4RandomNext; gives 2^128 non-overlapping
+ * sequences for parallel computations.
+ */
+static void
+p4RandomJump(uint64_t *s)
+{
+	static const uint64_t jump[] = {
+		0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+		0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+	};
+	uint64_t t[4] = { 0, 0, 0, 0 };
+
+	for (int i = 0; i < 4; i++) {
+		for (int b = 0; b < 64; b++) {
+			if (jump[i] & (uint64_t) 1 << b) {
+				t[0] ^= s[0];
+				t[1] ^= s[1];
+				t[2] ^= s[2];
+				t[3] ^= s[3];
+			}
+			(void) p4RandomNext(s);
+		}
+	}
+	(void) memcpy(s, t, sizeof (t));
+}
+
+/*
+ * The context is zero filled when created; an all zero state is the
+ * one invalid xoshiro state, so use it to seed on first use.
+ */
+static uint64_t *
+p4RandomState(P4_Ctx *ctx)
+{
+	uint64_t *s = ctx->random;
+	if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+		p4RandomSeed(s, P4_RANDOM_SEED);
+	}
+	return s;
+}
+
+/*
+ * Unbiased random number in [0, n) by rejecting the values below
+ * 2^64 mod n, which are the excess of the last partial interval.
+ */
+static uint64_t
+p4RandomRange(uint64_t *s, uint64_t n)
+{
+	uint64_t r, threshold = -n % n;
+	do {
+		r = p4RandomNext(s);
+	} while (r < threshold);
+	return r % n;
+}
+
+/*
+ * random ( -- u )
+ */
+static void
+p4Random(P4_Ctx *ctx)
+{
+	p4AllocStack(ctx, &ctx->ds, 1);
+	P4_PUSH(ctx->ds, (P4_Uint) p4RandomNext(p4RandomState(ctx)));
+}
+
+/*
+ * random-range ( u1 -- u2 )
+ */
+static void
+p4RandomRangeHook(P4_Ctx *ctx)
+{
+	P4_Uint n = P4_TOP(ctx->ds).u;
+	if (n == 0) {
+		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
+	}
+	P4_TOP(ctx->ds).u = (P4_Uint) p4RandomRange(p4RandomState(ctx), n);
+}
+
+/*
+ * random-fill ( caddr u -- )
+ */
+static void
+p4RandomFill(P4_Ctx *ctx)
+{
+	uint64_t r, *s = p4RandomState(ctx);
+	size_t n = P4_POP(ctx->ds).z;
+	char *buf = P4_POP(ctx->ds).s;
+
+	for ( ; sizeof (r) <= n; n -= sizeof (r), buf += sizeof (r)) {
+		r = p4RandomNext(s);
+		(void) memcpy(buf, &r, sizeof (r));
+	}
+	if (0 < n) {
+		r = p4RandomNext(s);
+		(void) memcpy(buf, &r, n);
+	}
+}
+
+/*
+ * random-seed ( u -- )
+ */
+static void
+p4RandomSeedHook(P4_Ctx *ctx)
+{
+	p4RandomSeed(ctx->random, P4_POP(ctx->ds).u);
+}
+
+/*
+ * random-jump ( -- )
+ */
+static void
+p4RandomJumpHook(P4_Ctx *ctx)
+{
+	p4RandomJump(p4RandomState(ctx));
+}
+
+#ifdef HAVE_MATH_H
+/*
+ * The top 53 bits scaled by 2^-53 give every double in [0, 1) that is
+ * a multiple of 2^-53 with equal probability.
+ */
+static inline P4_Float
+p4RandomFloat(uint64_t *s)
+{
+	return (P4_Float) (p4RandomNext(s) >> 11) * 0x1.0p-53;
+}
+
+/*
+ * frandom ( F: -- r )
+ */
+static void
+p4FRandom(P4_Ctx *ctx)
+{
+	P4_Cell c;
+	c.f = p4RandomFloat(p4RandomState(ctx));
+	p4AllocStack(ctx, &ctx->P4_FLOAT_STACK, 1);
+	P4_PUSH(ctx->P4_FLOAT_STACK, c);
+}
+
+/*
+ * frandom-fill ( faddr u -- )
+ */
+static void
+p4FRandomFill(P4_Ctx *ctx)
+{
+	uint64_t *s = p4RandomState(ctx);
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Float *x = P4_POP(ctx->ds).v;
+
+	for (size_t i = 0; i < n; i++) {
+		x[i] = p4RandomFloat(s);
+	}
+}
+#endif
+
+P4_Hook p4_random_hooks[] = {
+	P4_HOOK(0x01, "random", p4Random),
+	P4_HOOK(0x11, "random-range", p4RandomRangeHook),
+	P4_HOOK(0x20, "random-fill", p4RandomFill),
+	P4_HOOK(0x10, "random-seed", p4RandomSeedHook),
+	P4_HOOK(0x00, "random-jump", p4RandomJumpHook),
+#ifdef HAVE_MATH_H
+	P4_HOOK(0x010000, "frandom", p4FRandom),
+	P4_HOOK(0x20, "frandom-fill", p4FRandomFill),
+#endif
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
@@ -0,0 +1,331 @@
+/*
+ * sort.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_HOOKS
+
+#ifndef P4_SORT_INSERT_MAX
+#define P4_SORT_INSERT_MAX		16		/* in elements */
+#endif
+
+#ifndef P4_SORT_RADIX_MIN
+#define P4_SORT_RADIX_MIN		1024		/* in cells */
+#endif
+
+/*
+ * Introsort; quicksort with median-of-three pivot and a Hoare partition,
+ * falling back to heapsort when the recursion gets too deep, leaving
+ * short runs for a final insertion sort.  Instantiated per element type
+ * with LESS(s, i, j) and SWAP(s, i, j) operating on element indices of
+ * the sort state s, so the cell and float versions compile to tight
+ * loops, while SORT uses the same code with a Forth comparator.
+ */
+#define P4_SORT_DEFINE(name, S, LESS, SWAP)					\
+static void									\
+name##Sift(S s, size_t root, size_t lo, size_t n)				\
+{										\
+	size_t child;								\
+	for ( ; (child = 2 * root + 1) < n; root = child) {			\
+		if (child + 1 < n && LESS(s, lo + child, lo + child + 1)) {	\
+			child++;						\
+		}								\
+		if (!LESS(s, lo + root, lo + child)) {				\
+			break;							\
+		}								\
+		SWAP(s, lo + root, lo + child);					\
+	}									\
+}										\
+										\
+static void									\
+name##Heap(S s, size_t lo, size_t hi)						\
+{										\
+	size_t n = hi - lo;							\
+	for (size_t i = n / 2; 0 < i--; ) {					\
+		name##Sift(s, i, lo, n);					\
+	}									\
+	while (1 < n--) {							\
+		SWAP(s, lo, lo + n);						\
+		name##Sift(s, 0, lo, n);					\
+	}									\
+}										\
+										\
+static void									\
+name##Intro(S s, size_t lo, size_t hi, unsigned depth)				\
+{										\
+	size_t i, j, mid;							\
+	while (P4_SORT_INSERT_MAX < hi - lo) {					\
+		if (depth-- == 0) {						\
+			name##Heap(s, lo, hi);					\
+			return;							\
+		}								\
+		/* Median of three, leaving the pivot at lo. */			\
+		mid = lo + (hi - lo) / 2;					\
+		if (LESS(s, mid, lo)) {						\
+			SWAP(s, mid, lo);					\
+		}								\
+		if (LESS(s, hi - 1, mid)) {					\
+			SWAP(s, hi - 1, mid);					\
+			if (LESS(s, mid, lo)) {					\
+				SWAP(s, mid, lo);				\
+			}							\
+		}								\
+		SWAP(s, lo, mid);						\
+		/* Stop on equal keys to keep duplicates balanced.  The	\
+		 * bounds checks guard against inconsistent comparators.	\
+		 */								\
+		for (i = lo, j = hi; ; ) {					\
+			while (++i < hi && LESS(s, i, lo))			\
+				;						\
+			while (lo < --j && LESS(s, lo, j))			\
+				;						\
+			if (j <= i) {						\
+				break;						\
+			}							\
+			SWAP(s, i, j);						\
+		}								\
+		SWAP(s, lo, j);							\
+		/* Recurse into the smaller side, loop on the larger. */	\
+		if (j - lo < hi - j) {						\
+			name##Intro(s, lo, j, depth);				\
+			lo = j + 1;						\
+		} else {							\
+			name##Intro(s, j + 1, hi, depth);			\
+			hi = j;							\
+		}								\
+	}									\
+}										\
+										\
+static void									\
+name(S s, size_t n)								\
+{										\
+	unsigned depth = 2 * (P4_UINT_BITS - p4LeadZeroBits(n));		\
+	name##Intro(s, 0, n, depth);						\
+	for (size_t i = 1; i < n; i++) {					\
+		for (size_t j = i; 0 < j && LESS(s, j, j - 1); j--) {		\
+			SWAP(s, j, j - 1);					\
+		}								\
+	}									\
+}
+
+#define P4_SWAP_TYPE(T, a, i, j)	{ T t = (a)[i]; (a)[i] = (a)[j]; (a)[j] = t; }
+
+#define INT_LESS(a, i, j)		((a)[i].n < (a)[j].n)
+#define UINT_LESS(a, i, j)		((a)[i].u < (a)[j].u)
+#define CELL_SWAP(a, i, j)		P4_SWAP_TYPE(P4_Cell, a, i, j)
+
+P4_SORT_DEFINE(p4SortInts, P4_Cell *, INT_LESS, CELL_SWAP)
+P4_SORT_DEFINE(p4SortUints, P4_Cell *, UINT_LESS, CELL_SWAP)
+
+#ifdef HAVE_MATH_H
+/* NaN sorts after everything else, so a comparison never fails both ways. */
+#define FLOAT_LESS(a, i, j)		(isnan((a)[j]) ? !isnan((a)[i]) : (a)[i] < (a)[j])
+#define FLOAT_SWAP(a, i, j)		P4_SWAP_TYPE(P4_Float, a, i, j)
+
+P4_SORT_DEFINE(p4SortFloats, P4_Float *, FLOAT_LESS, FLOAT_SWAP)
+#endif
+
+/* (caddr u) pairs as stored by 2!, length first, ordered like COMPARE. */
+static int
+p4StringCmp(P4_Cell *a, P4_Cell *b)
+{
+	size_t n = a[0].z < b[0].z ? a[0].z : b[0].z;
+	int diff = memcmp(a[1].s, b[1].s, n);
+	if (diff == 0) {
+		return (b[0].z < a[0].z) - (a[0].z < b[0].z);
+	}
+	return diff;
+}
+
+#define STRING_LESS(a, i, j)		(p4StringCmp((a) + 2*(i), (a) + 2*(j)) < 0)
+#define STRING_SWAP(a, i, j)		{ P4_SWAP_TYPE(P4_Cell, a, 2*(i), 2*(j)); \
+					  P4_SWAP_TYPE(P4_Cell, a, 2*(i)+1, 2*(j)+1); }
+
+P4_SORT_DEFINE(p4SortStrings, P4_Cell *, STRING_LESS, STRING_SWAP)
+
+typedef struct {
+	P4_Ctx *	ctx;
+	P4_Xt		xt;
+	P4_Char *	base;
+	P4_Size		size;
+	P4_Char *	tmp;
+	int		rc;
+} P4_Sort_By;
+
+/*
+ * Call the Forth comparator ( addr1 addr2 -- n ).  Once an exception
+ * has been thrown, stop calling Forth and let the sort wind down.
+ */
+static int
+p4SortByLess(P4_Sort_By *s, size_t i, size_t j)
+{
+	P4_Ctx *ctx = s->ctx;
+	if (s->rc != P4_THROW_OK) {
+		return 0;
+	}
+	p4AllocStack(ctx, &ctx->ds, 2);
+	P4_PUSH(ctx->ds, (void *)(s->base + i * s->size));
+	P4_PUSH(ctx->ds, (void *)(s->base + j * s->size));
+	if ((s->rc = p4Call(ctx, s->xt)) != P4_THROW_OK) {
+		return 0;
+	}
+	if (P4_LENGTH(ctx->ds) < 1) {
+		s->rc = P4_THROW_DS_UNDER;
+		return 0;
+	}
+	return P4_POP(ctx->ds).n < 0;
+}
+
+#define BY_LESS(s, i, j)		p4SortByLess(s, i, j)
+#define BY_SWAP(s, i, j)		{ \
+	(void) memcpy((s)->tmp, (s)->base + (i) * (s)->size, (s)->size); \
+	(void) memcpy((s)->base + (i) * (s)->size, (s)->base + (j) * (s)->size, (s)->size); \
+	(void) memcpy((s)->base + (j) * (s)->size, (s)->tmp, (s)->size); \
+}
+
+P4_SORT_DEFINE(p4SortBy, P4_Sort_By *, BY_LESS, BY_SWAP)
+
+/*
+ * LSD radix sort, a byte per pass.  The sign bit is flipped for signed
+ * keys so negative numbers order first.  Passes where every key has the
+ * same digit are skipped, which is common for small ranges of values.
+ *
+ * @return
+ *	Zero on success; -1 if the temporary buffer cannot be allocated.
+ */
+static int
+p4RadixCells(P4_Cell *a, size_t n, P4_Uint flip)
+{
+	P4_Cell *src, *dst, *tmp;
+	size_t count[sizeof (P4_Uint)][256];
+
+	if ((tmp = malloc(n * sizeof (*tmp))) == NULL) {
+		return -1;
+	}
+	(void) memset(count, 0, sizeof (count));
+	for (size_t i = 0; i < n; i++) {
+		P4_Uint key = a[i].u ^ flip;
+		for (unsigned d = 0; d < sizeof (P4_Uint); d++) {
+			count[d][(key >> (d * CHAR_BIT)) & 0xFF]++;
+		}
+	}
+	src = a;
+	dst = tmp;
+	for (unsigned d = 0; d < sizeof (P4_Uint); d++) {
+		size_t sum = 0, *c = count[d];
+		unsigned shift = d * CHAR_BIT;
+		if (c[((src[0].u ^ flip) >> shift) & 0xFF] == n) {
+			continue;
+		}
+		for (unsigned b = 0; b < 256; b++) {
+			size_t t = c[b];
+			c[b] = sum;
+			sum += t;
+		}
+		for (size_t i = 0; i < n; i++) {
+			dst[c[((src[i].u ^ flip) >> shift) & 0xFF]++] = src[i];
+		}
+		P4_Cell *t = src; src = dst; dst = t;
+	}
+	if (src != a) {
+		(void) memcpy(a, src, n * sizeof (*a));
+	}
+	free(tmp);
+	return 0;
+}
+
+/*
+ * sort ( addr n size xt -- )
+ */
+static void
+p4Sort(P4_Ctx *ctx)
+{
+	P4_Sort_By s;
+	s.ctx = ctx;
+	s.rc = P4_THROW_OK;
+	s.xt = P4_POP(ctx->ds).xt;
+	s.size = P4_POP(ctx->ds).z;
+	size_t n = P4_POP(ctx->ds).z;
+	s.base = P4_POP(ctx->ds).v;
+	if (n < 2 || s.size == 0) {
+		return;
+	}
+	if ((s.tmp = malloc(s.size)) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	p4SortBy(&s, n);
+	free(s.tmp);
+	if (s.rc != P4_THROW_OK) {
+		LONGJMP(ctx->longjmp, s.rc);
+	}
+}
+
+static void
+p4SortCellsBy(P4_Ctx *ctx, P4_Uint flip)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	P4_Cell *a = P4_POP(ctx->ds).p;
+	if (n < P4_SORT_RADIX_MIN || p4RadixCells(a, n, flip) != 0) {
+		if (flip) {
+			p4SortInts(a, n);
+		} else {
+			p4SortUints(a, n);
+		}
+	}
+}
+
+/*
+ * sort-cells ( aaddr n -- )
+ */
+static void
+p4SortCells(P4_Ctx *ctx)
+{
+	p4SortCellsBy(ctx, P4_UINT_MSB);
+}
+
+/*
+ * sort-ucells ( aaddr n -- )
+ */
+static void
+p4SortUcells(P4_Ctx *ctx)
+{
+	p4SortCellsBy(ctx, 0);
+}
+
+#ifdef HAVE_MATH_H
+/*
+ * sort-floats ( faddr n -- )
+ */
+static void
+p4SortFloatsHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	p4SortFloats(P4_POP(ctx->ds).v, n);
+}
+#endif
+
+/*
+ * sort-strings ( aaddr n -- )
+ */
+static void
+p4SortStringsHook(P4_Ctx *ctx)
+{
+	size_t n = P4_POP(ctx->ds).z;
+	p4SortStrings(P4_POP(ctx->ds).p, n);
+}
+
+P4_Hook p4_sort_hooks[] = {
+	P4_HOOK(0x40, "sort", p4Sort),
+	P4_HOOK(0x20, "sort-cells", p4SortCells),
+	P4_HOOK(0x20, "sort-ucells", p4SortUcells),
+#ifdef HAVE_MATH_H
+	P4_HOOK(0x20, "sort-floats", p4SortFloatsHook),
+#endif
+	P4_HOOK(0x20, "sort-strings", p4SortStringsHook),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
@@ -0,0 +1,205 @@
+/*
+ * stats.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#ifdef HAVE_STATS
+
+#ifndef P4_STATS_WORDS
+#define P4_STATS_WORDS		40		/* words reported */
+#endif
+
+static int
+p4WordByCount(const void *a, const void *b)
+{
+	const P4_Word *x = *(const P4_Word **) a, *y = *(const P4_Word **) b;
+	return (x->count < y->count) - (y->count < x->count);
+}
+
+static const char *phase_names[P4_PHASES] = {
+	"", "parse", "find", "number", "compile", "execute"
+};
+
+static P4_Phase_File *
+p4PhaseFile(P4_Ctx *ctx, const char *path)
+{
+	P4_Phase_File *file;
+
+	if (path == NULL) {
+		path = "";
+	}
+	/* Paths are compared by content; an INCLUDE's path string can be
+	 * freed and its memory reused by another.
+	 */
+	if ((file = ctx->stats.phase_file) != NULL && strcmp(file->path, path) == 0) {
+		return file;
+	}
+	for (file = ctx->stats.files; file != NULL; file = file->next) {
+		if (strcmp(file->path, path) == 0) {
+			return file;
+		}
+	}
+	if ((file = calloc(1, sizeof (*file))) == NULL) {
+		return NULL;
+	}
+	if ((file->path = strdup(path)) == NULL) {
+		free(file);
+		return NULL;
+	}
+	file->next = ctx->stats.files;
+	ctx->stats.files = file;
+	return file;
+}
+
+void
+p4StatsPhase(P4_Ctx *ctx, P4_Phase phase)
+{
+	uint64_t now = p4ClockNs();
+
+	if (ctx->stats.phase_file != NULL && ctx->stats.phase != P4_PHASE_NONE) {
+		ctx->stats.phase_file->ns[ctx->stats.phase] += now - ctx->stats.phase_ns;
+		ctx->stats.phase_file->count[ctx->stats.phase]++;
+	}
+	ctx->stats.phase = phase;
+	ctx->stats.phase_ns = now;
+	if (phase != P4_PHASE_NONE) {
+		ctx->stats.phase_file = p4PhaseFile(ctx, ctx->input->path);
+	}
+}
+
+static void
+p4PhaseReport(P4_Ctx *ctx, FILE *fp)
+{
+	if (ctx->stats.files == NULL) {
+		return;
+	}
+	(void) fprintf(fp, "phases     ");
+	for (int i = P4_PHASE_PARSE; i < P4_PHASES; i++) {
+		(void) fprintf(fp, " %12s", phase_names[i]);
+	}
+	(void) fprintf(fp, NL);
+	for (P4_Phase_File *file = ctx->stats.files; file != NULL; file = file->next) {
+		(void) fprintf(fp, "%s" NL "  calls    ", file->path);
+		for (int i = P4_PHASE_PARSE; i < P4_PHASES; i++) {
+			(void) fprintf(fp, " %12" PRIu64, (uint64_t) file->count[i]);
+		}
+		(void) fprintf(fp, NL "  ms       ");
+		for (int i = P4_PHASE_PARSE; i < P4_PHASES; i++) {
+			(void) fprintf(fp, " %12.3f", file->ns[i] / 1e6);
+		}
+		(void) fprintf(fp, NL);
+	}
+}
+
+void
+p4StatsFree(P4_Ctx *ctx)
+{
+	P4_Phase_File *file, *next;
+
+	for (file = ctx->stats.files; file != NULL; file = next) {
+		next = file->next;
+		free(file->path);
+		free(file);
+	}
+	ctx->stats.files = NULL;
+	ctx->stats.phase_file = NULL;
+}
+
+void
+p4StatsReport(P4_Ctx *ctx, FILE *fp)
+{
+	P4_Word **words;
+	size_t n, count = 0;
+	uint64_t total = 0;
+
+	(void) fprintf(fp, "enter          %12" PRIu64 " exit %12" PRIu64 "" NL,
+		(uint64_t) ctx->stats.enter, (uint64_t) ctx->stats.exit
+	);
+	(void) fprintf(fp, "alloc stack    %12" PRIu64 " calls %11" PRIu64 " reallocs" NL,
+		(uint64_t) ctx->stats.alloc_stack, (uint64_t) ctx->stats.realloc_stack
+	);
+	(void) fprintf(fp, "find name      %12" PRIu64 " calls %11" PRIu64 " compares %8" PRIu64 " misses" NL,
+		(uint64_t) ctx->stats.find_name, (uint64_t) ctx->stats.find_compare,
+		(uint64_t) ctx->stats.find_miss
+	);
+	(void) fprintf(fp, "str num        %12" PRIu64 " calls" NL, (uint64_t) ctx->stats.str_num);
+	(void) fprintf(fp, "setjmp         %12" PRIu64 " entries %9" PRIu64 " longjmps %8" PRIu64 " throws" NL,
+		(uint64_t) ctx->stats.setjmp, (uint64_t) ctx->stats.longjmp,
+		(uint64_t) ctx->stats.throws
+	);
+
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		for (P4_Word *word = ctx->lists[i]; word != NULL; word = word->prev) {
+			count += 0 < word->count;
+			total += word->count;
+		}
+	}
+	p4PhaseReport(ctx, fp);
+	(void) fprintf(fp, "executions     %12" PRIu64 " words %11zu executed" NL, total, count);
+	if (count == 0 || (words = malloc(count * sizeof (*words))) == NULL) {
+		return;
+	}
+	n = 0;
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		for (P4_Word *word = ctx->lists[i]; word != NULL; word = word->prev) {
+			if (0 < word->count) {
+				words[n++] = word;
+			}
+		}
+	}
+	qsort(words, count, sizeof (*words), p4WordByCount);
+	for (n = 0; n < count && n < P4_STATS_WORDS; n++) {
+		(void) fprintf(fp, "  %-28.*s%12" PRIu64 " %5.1f%%" NL,
+			0 < words[n]->length ? (int) words[n]->length : 7,
+			0 < words[n]->length ? words[n]->name : ":NONAME",
+			(uint64_t) words[n]->count, 100.0 * words[n]->count / total
+		);
+	}
+	free(words);
+}
+
+void
+p4StatsReset(P4_Ctx *ctx)
+{
+	p4StatsFree(ctx);
+	(void) memset(&ctx->stats, 0, sizeof (ctx->stats));
+	for (int i = -1; i < P4_WORDLISTS; i++) {
+		for (P4_Word *word = ctx->lists[i]; word != NULL; word = word->prev) {
+			word->count = 0;
+		}
+	}
+}
+
+#ifdef HAVE_HOOKS
+
+/*
+ * vm-stats ( -- )
+ */
+static void
+p4VmStats(P4_Ctx *ctx)
+{
+	(void) fflush(stdout);
+	p4StatsReport(ctx, stdout);
+}
+
+/*
+ * vm-stats-reset ( -- )
+ */
+static void
+p4VmStatsReset(P4_Ctx *ctx)
+{
+	p4StatsReset(ctx);
+}
+
+P4_Hook p4_stats_hooks[] = {
+	P4_HOOK(0x00, "vm-stats", p4VmStats),
+	P4_HOOK(0x00, "vm-stats-reset", p4VmStatsReset),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */
+
+#endif /* HAVE_STATS */
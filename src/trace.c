@@ -0,0 +1,754 @@
+/*
+ * trace.c
+ *
+ * Copyright 2007, 2025 by Anthony Howe. All rights reserved.
+ */
+
+#include "post4.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+#endif
+
+/*
+ * Binary tracing writes a fixed size record per word executed into
+ * a ring, in memory or a memory mapped file, instead of formatting a
+ * line of text.  The records are rendered in the text format of -T
+ * only when dumped, possibly by another process in the case of a file.
+ */
+#ifndef P4_TRACE_RECORDS
+#define P4_TRACE_RECORDS	65536		/* default ring size */
+#endif
+#ifndef P4_TRACE_CELLS
+#define P4_TRACE_CELLS		3		/* top cells per stack */
+#endif
+#ifndef P4_TRACE_NAME
+#define P4_TRACE_NAME		32		/* incl. NUL */
+#endif
+#ifndef P4_TRACE_FILTER
+#define P4_TRACE_FILTER		64		/* initial filter hash size */
+#endif
+#ifndef P4_TRACE_FRAMES
+#define P4_TRACE_FRAMES		16		/* initial traced word nesting */
+#endif
+
+#define P4_TRACE_MAGIC		"P4TRACE"
+
+/* Largest power of 2 that fits P4_Trace_Ring.count. */
+#define P4_TRACE_MAX		((P4_Uint) UINT32_MAX / 2 + 1)
+
+typedef struct {
+	uint64_t	time;		/* nanoseconds */
+	uint64_t	xt;
+	uint64_t	ip;
+	int32_t		ds;		/* stack depths */
+	int32_t		fs;
+	int32_t		rs;
+	int32_t		level;
+	uint32_t	poppush;
+	uint8_t		nlit;		/* cells saved below */
+	uint8_t		nds;
+	uint8_t		nfs;
+	uint8_t		nrs;
+	P4_Cell		lit[P4_TRACE_CELLS];
+	P4_Cell		dstk[P4_TRACE_CELLS];	/* Top last. */
+	P4_Cell		fstk[P4_TRACE_CELLS];
+	P4_Cell		rstk[P4_TRACE_CELLS];
+	char		name[P4_TRACE_NAME];
+} P4_Trace_Rec;
+
+typedef struct {
+	char		magic[8];
+	uint32_t	size;		/* sizeof (P4_Trace_Rec) */
+	uint32_t	count;		/* records, power of 2 */
+	uint64_t	next;		/* records written */
+	P4_Trace_Rec	rec[];
+} P4_Trace_Ring;
+
+/*
+ * A traced word has exited when control is back at its return stack
+ * depth, either at its return address or, for a word that never went
+ * deeper (a primitive), at the next word.  Less than its depth means
+ * an exception unwound it.
+ */
+typedef struct {
+	P4_Xt		xt;
+	const P4_Cell *	ip;		/* Return address. */
+	ptrdiff_t	rs;		/* Return stack depth on entry. */
+	int		deeper;
+} P4_Trace_Frame;
+
+typedef struct {
+	int		on;
+	int		mapped;
+	size_t		length;		/* bytes */
+	P4_Trace_Ring *	ring;
+	size_t		nfilter;
+	size_t		fsize;
+	const P4_Word **filter;		/* Only these words, if any. */
+	uint64_t	t0;		/* First traced word entry. */
+	size_t		nframes;
+	size_t		mframes;
+	P4_Trace_Frame *frames;		/* Traced words not yet exited. */
+} P4_Tracer;
+
+static size_t
+p4TraceSlot(const P4_Tracer *tr, const P4_Word *xt)
+{
+	return (size_t) (((P4_Uint) xt >> 4) * 0x9E3779B97F4A7C15ULL) & (tr->fsize - 1);
+}
+
+static int
+p4TraceFiltered(const P4_Tracer *tr, const P4_Word *xt)
+{
+	for (size_t i = p4TraceSlot(tr, xt); tr->filter[i] != NULL; i = (i + 1) & (tr->fsize - 1)) {
+		if (tr->filter[i] == xt) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int
+p4TraceFilterAdd(P4_Tracer *tr, const P4_Word *xt)
+{
+	size_t i, n;
+	const P4_Word **old;
+
+	/* Keep the table at most half full. */
+	if (tr->fsize < 2 * (tr->nfilter + 1)) {
+		n = tr->fsize == 0 ? P4_TRACE_FILTER : 2 * tr->fsize;
+		old = tr->filter;
+		if ((tr->filter = calloc(n, sizeof (*tr->filter))) == NULL) {
+			tr->filter = old;
+			return -1;
+		}
+		i = tr->fsize;
+		tr->fsize = n;
+		while (0 < i--) {
+			if (old[i] != NULL) {
+				for (n = p4TraceSlot(tr, old[i]); tr->filter[n] != NULL; n = (n + 1) & (tr->fsize - 1)) {
+					;
+				}
+				tr->filter[n] = old[i];
+			}
+		}
+		free(old);
+	}
+	for (i = p4TraceSlot(tr, xt); tr->filter[i] != NULL; i = (i + 1) & (tr->fsize - 1)) {
+		if (tr->filter[i] == xt) {
+			return 0;
+		}
+	}
+	tr->filter[i] = xt;
+	tr->nfilter++;
+	return 0;
+}
+
+static void
+p4TraceUnmap(P4_Tracer *tr)
+{
+	if (tr->ring != NULL) {
+#if defined(__unix__) || defined(__APPLE__)
+		if (tr->mapped) {
+			(void) munmap(tr->ring, tr->length);
+		} else
+#endif
+		{
+			free(tr->ring);
+		}
+	}
+	tr->ring = NULL;
+	tr->mapped = 0;
+	tr->on = 0;
+}
+
+static P4_Tracer *
+p4TraceGet(P4_Ctx *ctx)
+{
+	if (ctx->tracer == NULL) {
+		ctx->tracer = calloc(1, sizeof (P4_Tracer));
+	}
+	return ctx->tracer;
+}
+
+/* Round up the number of records to a power of 2; zero for the default.
+ * Assumes n is at most P4_TRACE_MAX.
+ */
+static size_t
+p4TraceCount(P4_Uint n)
+{
+	size_t count;
+
+	if (n == 0) {
+		n = P4_TRACE_RECORDS;
+	}
+	for (count = 1; count < n; count <<= 1) {
+		;
+	}
+	return count;
+}
+
+/* Replace any previous ring, only once the new ring exists. */
+static void
+p4TraceInit(P4_Ctx *ctx, P4_Tracer *tr, P4_Trace_Ring *ring, size_t length, int mapped, size_t count)
+{
+	p4TraceUnmap(tr);
+	tr->ring = ring;
+	tr->length = length;
+	tr->mapped = mapped;
+	(void) memcpy(tr->ring->magic, P4_TRACE_MAGIC, sizeof (P4_TRACE_MAGIC));
+	tr->ring->size = sizeof (P4_Trace_Rec);
+	tr->ring->count = count;
+	tr->ring->next = 0;
+	tr->on = 1;
+	if (ctx->trace == 0 || ctx->trace == P4_TRACE_HOOKS) {
+		ctx->trace = 1;
+	}
+}
+
+int
+p4TraceStart(P4_Ctx *ctx, P4_Uint n)
+{
+	P4_Tracer *tr;
+	P4_Trace_Ring *ring;
+	size_t count, length;
+
+	if (P4_TRACE_MAX < n) {
+		errno = EINVAL;
+		return -1;
+	}
+	count = p4TraceCount(n);
+	length = sizeof (*ring) + count * sizeof (P4_Trace_Rec);
+	if ((tr = p4TraceGet(ctx)) == NULL || (ring = malloc(length)) == NULL) {
+		return -1;
+	}
+	p4TraceInit(ctx, tr, ring, length, 0, count);
+	return 0;
+}
+
+int
+p4TraceStartFile(P4_Ctx *ctx, const char *path, P4_Uint n)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	int fd;
+	void *ring;
+	P4_Tracer *tr;
+	size_t count, length;
+
+	if (P4_TRACE_MAX < n) {
+		errno = EINVAL;
+		return -1;
+	}
+	count = p4TraceCount(n);
+	length = sizeof (P4_Trace_Ring) + count * sizeof (P4_Trace_Rec);
+	if ((tr = p4TraceGet(ctx)) == NULL) {
+		return -1;
+	}
+	if ((fd = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644)) < 0) {
+		return -1;
+	}
+	if (ftruncate(fd, length)) {
+		(void) close(fd);
+		return -1;
+	}
+	ring = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	(void) close(fd);
+	if (ring == MAP_FAILED) {
+		return -1;
+	}
+	p4TraceInit(ctx, tr, ring, length, 1, count);
+	return 0;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+void
+p4TraceStop(P4_Ctx *ctx)
+{
+	P4_Tracer *tr = ctx->tracer;
+
+	if (tr != NULL) {
+		tr->on = 0;
+	}
+	ctx->trace = 0;
+	p4TraceHooks(ctx);
+}
+
+void
+p4TraceHooks(P4_Ctx *ctx)
+{
+	int hooked = 0 < ctx->traced || p4Covering(ctx);
+
+	if (ctx->trace == 0 && hooked) {
+		ctx->trace = P4_TRACE_HOOKS;
+	} else if (ctx->trace == P4_TRACE_HOOKS && !hooked) {
+		ctx->trace = 0;
+	}
+}
+
+int
+p4TraceBinary(P4_Ctx *ctx)
+{
+	P4_Tracer *tr = ctx->tracer;
+	return tr != NULL && tr->on;
+}
+
+void
+p4TraceFree(P4_Ctx *ctx)
+{
+	P4_Tracer *tr = ctx->tracer;
+
+	if (tr != NULL) {
+		p4TraceUnmap(tr);
+		free(tr->filter);
+		free(tr->frames);
+		free(tr);
+		ctx->tracer = NULL;
+	}
+}
+
+/* Save up to P4_TRACE_CELLS of the top u cells, deepest first. */
+static uint8_t
+p4TraceCells(P4_Cell *cells, P4_Stack *stk, unsigned u)
+{
+	ptrdiff_t depth = P4_PLENGTH(stk);
+
+	if (depth < (ptrdiff_t) u) {
+		u = depth < 0 ? 0 : (unsigned) depth;
+	}
+	if (P4_TRACE_CELLS < u) {
+		u = P4_TRACE_CELLS;
+	}
+	for (unsigned i = 0; i < u; i++) {
+		cells[i] = stk->top[(ptrdiff_t) i + 1 - (ptrdiff_t) u];
+	}
+	return (uint8_t) u;
+}
+
+static void
+p4TraceFill(P4_Ctx *ctx, P4_Trace_Rec *rec, P4_Xt xt, const P4_Cell *ip)
+{
+	unsigned n;
+
+	rec->time = p4ClockNs();
+	rec->xt = (uint64_t) (uintptr_t) xt;
+	rec->ip = (uint64_t) (uintptr_t) ip;
+	rec->ds = (int32_t) P4_LENGTH(ctx->ds);
+	rec->fs = (int32_t) P4_LENGTH(ctx->fs);
+	rec->rs = (int32_t) P4_LENGTH(ctx->rs);
+	rec->level = (int32_t) ctx->level;
+	rec->poppush = xt->poppush;
+	n = P4_WD_LIT(xt);
+	rec->nlit = n < P4_TRACE_CELLS ? n : P4_TRACE_CELLS;
+	for (n = 0; n < rec->nlit; n++) {
+		rec->lit[n] = ip[n];
+	}
+	rec->nds = rec->nfs = rec->nrs = 0;
+	if (xt->poppush & 0xF0F0F0) {
+		rec->nds = p4TraceCells(rec->dstk, &ctx->ds, P4_DS_CAN_POP(xt));
+		rec->nfs = p4TraceCells(rec->fstk, &ctx->fs, P4_FS_CAN_POP(xt));
+		rec->nrs = p4TraceCells(rec->rstk, &ctx->rs, P4_RS_CAN_POP(xt));
+	}
+	if (xt->length == 0) {
+		(void) memcpy(rec->name, ":NONAME", sizeof (":NONAME"));
+	} else {
+		n = xt->length < P4_TRACE_NAME ? xt->length : P4_TRACE_NAME - 1;
+		(void) memcpy(rec->name, xt->name, n);
+		rec->name[n] = '\0';
+	}
+}
+
+int
+p4TraceRecord(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip)
+{
+	P4_Tracer *tr = ctx->tracer;
+
+	if (tr == NULL || !tr->on) {
+		return 0;
+	}
+	if (0 < tr->nfilter && !p4TraceFiltered(tr, xt)) {
+		return 1;
+	}
+	p4TraceFill(ctx, &tr->ring->rec[tr->ring->next++ & (tr->ring->count - 1)], xt, ip);
+	return 1;
+}
+
+static void
+p4TraceCellsRender(FILE *fp, const P4_Cell *cells, unsigned n, unsigned u, const char *prefix)
+{
+	(void) fprintf(fp, "%s%s", prefix, 0 < n ? "" : "-");
+	/* More cells popped than were saved. */
+	if (n < u && 0 < n) {
+		(void) fputs("... ", fp);
+	}
+	for (unsigned i = 0; i < n; i++) {
+		int is_small = -65536 < cells[i].n && cells[i].n < 65536;
+		(void) fprintf(fp, is_small ? P4_INT_FMT"%s" : P4_HEX_FMT"%s", cells[i].n, i + 1 < n ? " " : "");
+	}
+}
+
+/*
+ * Render a record in the format of -T, preceded by the nanoseconds
+ * since the first record.
+ */
+static void
+p4TraceRender(FILE *fp, const P4_Trace_Rec *rec, uint64_t t0)
+{
+	P4_Word w;
+
+	w.poppush = rec->poppush;
+#ifdef HAVE_MATH_H
+	(void) fprintf(
+		fp, "%10" PRIu64 " ds=%-2d fs=%-2d rs=%-2d %*s%s ",
+		rec->time - t0, (int) rec->ds, (int) rec->fs, (int) rec->rs,
+		2 * (int) rec->level, "", rec->name
+	);
+#else
+	(void) fprintf(
+		fp, "%10" PRIu64 " ds=%-2d rs=%-2d %*s%s ",
+		rec->time - t0, (int) rec->ds, (int) rec->rs,
+		2 * (int) rec->level, "", rec->name
+	);
+#endif
+	for (unsigned i = 0; i < rec->nlit; i++) {
+		int is_small = -65536 < rec->lit[i].n && rec->lit[i].n < 65536;
+		(void) fprintf(fp, is_small ? P4_INT_FMT" " : P4_HEX_FMT" ", rec->lit[i].n);
+	}
+	if (rec->poppush & 0xF0F0F0) {
+		p4TraceCellsRender(fp, rec->dstk, rec->nds, P4_DS_CAN_POP(&w), "\t");
+#ifdef HAVE_MATH_H
+		p4TraceCellsRender(fp, rec->fstk, rec->nfs, P4_FS_CAN_POP(&w), " ; ");
+#endif
+		p4TraceCellsRender(fp, rec->rstk, rec->nrs, P4_RS_CAN_POP(&w), " ; ");
+	}
+	(void) fputs(newline, fp);
+}
+
+/* Render the ring, oldest record first. */
+static void
+p4TraceRenderRing(FILE *fp, const P4_Trace_Ring *ring)
+{
+	uint64_t i = ring->count < ring->next ? ring->next - ring->count : 0;
+	const P4_Trace_Rec *rec = &ring->rec[i & (ring->count - 1)];
+	uint64_t t0 = rec->time;
+
+	for ( ; i < ring->next; i++) {
+		p4TraceRender(fp, &ring->rec[i & (ring->count - 1)], t0);
+	}
+}
+
+/*
+ * Render the entry (>) or exit (<, or <! when unwound) of a traced
+ * word.  The entry shows the cells the word can pop and the exit those
+ * it can push; if the stack effect is unknown, the top of the data
+ * stack.
+ */
+static void
+p4TraceWordLog(P4_Ctx *ctx, P4_Tracer *tr, P4_Xt xt, const P4_Cell *ip, const char *mark, int is_exit)
+{
+	P4_Word w;
+	ptrdiff_t depth;
+	P4_Trace_Rec rec;
+
+	w.length = xt->length;
+	w.name = xt->name;
+	w.poppush = is_exit ? (xt->poppush & 0x0F0F0F) << 4 : xt->poppush;
+	if ((w.poppush & 0xF0F0F0) == 0) {
+		depth = P4_PLENGTH(&ctx->ds);
+		w.poppush |= (depth < P4_TRACE_CELLS ? (P4_Uint) depth : P4_TRACE_CELLS) << 4;
+	}
+	p4TraceFill(ctx, &rec, &w, ip);
+	rec.xt = (uint64_t) (uintptr_t) xt;
+	/* Indent by traced words, not every word, still active. */
+	rec.level = (int32_t) tr->nframes;
+	(void) snprintf(rec.name, sizeof (rec.name), "%s %.*s", mark,
+		0 < xt->length ? (int) xt->length : 7,
+		0 < xt->length ? xt->name : ":NONAME"
+	);
+	if (tr->t0 == 0) {
+		tr->t0 = rec.time;
+	}
+	p4TraceRender(STDERR, &rec, tr->t0);
+}
+
+void
+p4TraceWord(P4_Ctx *ctx, P4_Xt xt, const P4_Cell *ip)
+{
+	P4_Trace_Frame *f;
+	P4_Tracer *tr = ctx->tracer;
+	ptrdiff_t rs = P4_PLENGTH(&ctx->rs);
+
+	while (tr != NULL && 0 < tr->nframes) {
+		f = &tr->frames[tr->nframes - 1];
+		if (f->rs < rs) {
+			f->deeper = 1;
+			break;
+		}
+		/* The next word is fetched and ip advanced before p4Trace(). */
+		if (f->rs == rs && f->deeper && f->ip != ip - 1) {
+			break;
+		}
+		tr->nframes--;
+		p4TraceWordLog(ctx, tr, f->xt, ip, rs < f->rs ? "<!" : "<", 1);
+	}
+	if (!P4_WORD_IS_TRACE(xt) || (tr = p4TraceGet(ctx)) == NULL) {
+		return;
+	}
+	if (tr->nframes == tr->mframes) {
+		size_t m = tr->mframes == 0 ? P4_TRACE_FRAMES : tr->mframes * 2;
+		if ((f = realloc(tr->frames, m * sizeof (*f))) == NULL) {
+			return;
+		}
+		tr->frames = f;
+		tr->mframes = m;
+	}
+	p4TraceWordLog(ctx, tr, xt, ip, ">", 0);
+	f = &tr->frames[tr->nframes++];
+	f->xt = xt;
+	f->ip = ip;
+	f->rs = rs;
+	f->deeper = 0;
+}
+
+void
+p4TraceDump(P4_Ctx *ctx, FILE *fp)
+{
+	P4_Tracer *tr = ctx->tracer;
+
+	if (tr != NULL && tr->ring != NULL) {
+		p4TraceRenderRing(fp, tr->ring);
+	}
+}
+
+int
+p4TraceDecode(const char *path, FILE *fp)
+{
+	FILE *in;
+	size_t length;
+	P4_Trace_Ring head, *ring;
+
+	if ((in = fopen(path, "rb")) == NULL) {
+		return -1;
+	}
+	if (fread(&head, sizeof (head), 1, in) != 1
+	|| memcmp(head.magic, P4_TRACE_MAGIC, sizeof (P4_TRACE_MAGIC)) != 0
+	|| head.size != sizeof (P4_Trace_Rec) || head.count == 0
+	|| (head.count & (head.count - 1)) != 0) {
+		/* Not a trace or from an incompatible build. */
+		(void) fclose(in);
+		errno = EINVAL;
+		return -1;
+	}
+	length = sizeof (head) + head.count * sizeof (P4_Trace_Rec);
+	if ((ring = malloc(length)) == NULL) {
+		(void) fclose(in);
+		return -1;
+	}
+	*ring = head;
+	if (fread(ring->rec, sizeof (P4_Trace_Rec), head.count, in) != head.count) {
+		free(ring);
+		(void) fclose(in);
+		errno = EIO;
+		return -1;
+	}
+	(void) fclose(in);
+	p4TraceRenderRing(fp, ring);
+	free(ring);
+	return 0;
+}
+
+#ifdef HAVE_HOOKS
+
+/*
+ * trace-on ( u -- )
+ */
+static void
+p4TraceOn(P4_Ctx *ctx)
+{
+	P4_Uint n = P4_POP(ctx->ds).u;
+	if (P4_TRACE_MAX < n) {
+		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
+	}
+	if (p4TraceStart(ctx, n)) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+}
+
+/*
+ * trace-file ( caddr u1 u2 -- ior )
+ */
+static void
+p4TraceFile(P4_Ctx *ctx)
+{
+	int rc = -1;
+	char *path;
+	P4_Uint n = P4_POP(ctx->ds).u;
+	P4_Uint u = P4_POP(ctx->ds).u;
+
+	if (P4_TRACE_MAX < n) {
+		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
+	}
+	if ((path = strndup(P4_TOP(ctx->ds).s, u)) != NULL) {
+		rc = p4TraceStartFile(ctx, path, n);
+		free(path);
+	}
+	P4_TOP(ctx->ds).n = rc == 0 ? 0 : errno;
+}
+
+/*
+ * trace-off ( -- )
+ */
+static void
+p4TraceOff(P4_Ctx *ctx)
+{
+	p4TraceStop(ctx);
+}
+
+/*
+ * trace-dump ( -- )
+ */
+static void
+p4TraceDumpHook(P4_Ctx *ctx)
+{
+	(void) fflush(stdout);
+	p4TraceDump(ctx, stdout);
+}
+
+/*
+ * trace-decode ( caddr u -- ior )
+ */
+static void
+p4TraceDecodeHook(P4_Ctx *ctx)
+{
+	int rc = -1;
+	char *path;
+	P4_Uint u = P4_POP(ctx->ds).u;
+
+	if ((path = strndup(P4_TOP(ctx->ds).s, u)) != NULL) {
+		(void) fflush(stdout);
+		rc = p4TraceDecode(path, stdout);
+		free(path);
+	}
+	P4_TOP(ctx->ds).n = rc == 0 ? 0 : errno;
+}
+
+/*
+ * trace-filter ( xt -- )
+ */
+static void
+p4TraceFilter(P4_Ctx *ctx)
+{
+	P4_Tracer *tr;
+	P4_Xt xt = P4_POP(ctx->ds).xt;
+
+	if ((tr = p4TraceGet(ctx)) == NULL || p4TraceFilterAdd(tr, xt)) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+}
+
+/*
+ * trace-filter-list ( wid -- )
+ */
+static void
+p4TraceFilterList(P4_Ctx *ctx)
+{
+	P4_Tracer *tr;
+	P4_Int wid = P4_POP(ctx->ds).n;
+
+	if (wid < 1 || P4_WORDLISTS < wid) {
+		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
+	}
+	if ((tr = p4TraceGet(ctx)) == NULL) {
+		LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+	}
+	for (P4_Word *word = ctx->lists[wid-1]; word != NULL; word = word->prev) {
+		if (p4TraceFilterAdd(tr, word)) {
+			LONGJMP(ctx->longjmp, P4_THROW_ALLOCATE);
+		}
+	}
+}
+
+/*
+ * trace-filter-clear ( -- )
+ */
+static void
+p4TraceFilterClear(P4_Ctx *ctx)
+{
+	P4_Tracer *tr = ctx->tracer;
+
+	if (tr != NULL) {
+		free(tr->filter);
+		tr->filter = NULL;
+		tr->fsize = tr->nfilter = 0;
+	}
+}
+
+/*
+ * trace-word ( xt -- )
+ */
+static void
+p4TraceWordHook(P4_Ctx *ctx)
+{
+	P4_Xt xt = P4_POP(ctx->ds).xt;
+
+	if (!P4_WORD_IS_TRACE(xt)) {
+		P4_WORD_SET_TRACE(xt);
+		ctx->traced++;
+	}
+	p4TraceHooks(ctx);
+}
+
+/*
+ * untrace-word ( xt -- )
+ */
+static void
+p4UntraceWord(P4_Ctx *ctx)
+{
+	P4_Xt xt = P4_POP(ctx->ds).xt;
+
+	if (P4_WORD_IS_TRACE(xt)) {
+		P4_WORD_CLEAR_TRACE(xt);
+		ctx->traced--;
+	}
+	p4TraceHooks(ctx);
+}
+
+/*
+ * trace-list ( wid -- )
+ */
+static void
+p4TraceList(P4_Ctx *ctx)
+{
+	P4_Int wid = P4_POP(ctx->ds).n;
+
+	if (wid < 1 || P4_WORDLISTS < wid) {
+		LONGJMP(ctx->longjmp, P4_THROW_EINVAL);
+	}
+	for (P4_Word *word = ctx->lists[wid-1]; word != NULL; word = word->prev) {
+		if (!P4_WORD_IS_TRACE(word)) {
+			P4_WORD_SET_TRACE(word);
+			ctx->traced++;
+		}
+	}
+	p4TraceHooks(ctx);
+}
+
+P4_Hook p4_trace_hooks[] = {
+	P4_HOOK(0x10, "trace-on", p4TraceOn),
+	P4_HOOK(0x31, "trace-file", p4TraceFile),
+	P4_HOOK(0x00, "trace-off", p4TraceOff),
+	P4_HOOK(0x00, "trace-dump", p4TraceDumpHook),
+	P4_HOOK(0x21, "trace-decode", p4TraceDecodeHook),
+	P4_HOOK(0x10, "trace-filter", p4TraceFilter),
+	P4_HOOK(0x10, "trace-filter-list", p4TraceFilterList),
+	P4_HOOK(0x00, "trace-filter-clear", p4TraceFilterClear),
+	P4_HOOK(0x10, "trace-word", p4TraceWordHook),
+	P4_HOOK(0x10, "untrace-word", p4UntraceWord),
+	P4_HOOK(0x10, "trace-list", p4TraceList),
+	{ 0, 0, NULL, NULL }
+};
+
+#endif /* HAVE_HOOKS */